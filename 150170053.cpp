@@ -1,607 +1,408 @@
 /**
- * Compile: g++ -std=c++11 -Wall 150170053.cpp
- * Run:     ./a.out filename.csv
- * 
+ * Compile: g++ -std=c++11 -Wall -pthread 150170053.cpp
+ *          (add -DRBT_STATS for tree operation counters in --stats)
+ * Run:     ./a.out [--intern] [--dump=full|off|changed|binary] [--top=K]
+ *                 [--prefix=STR] [--retire=N] [--jobs=N] [--save=FILE]
+ *                 [--load=FILE] [--backend=rb|compact|btree|persistent]
+ *                 [--stats=FILE] [--verify=N] [--teams] [--history]
+ *                 [--career=NAME] [--as-of=SEASON,NAME] [--leaders=FROM,TO]
+ *                 [--pipeline] filename.csv
+ *
  * @author Koray Kural
  * @date 09/01/2021
  */
 #include <iostream>
-#include <fstream> // ifstream
+#include <cstdlib>    // strtoul, atoi
+#include <cstring>    // strcmp, strncmp
+#include <functional> // ref
+#include <thread>
+
+#include "include/CsvReader.h"
+#include "include/League.h"
+#include "include/OutputBuffer.h"
+#include "include/ParallelReader.h"
+#include "include/PlayerKeys.h"
+#include "include/ReportWriter.h"
+#include "include/SpscQueue.h"
 
 using namespace std;
 
-enum Color
-{
-    RED,
-    BLACK,
-};
-
-template <class Data, class Key>
-struct Node
+/**
+ * Adds a row to the league. Prints the reports first if the row starts a
+ * new season.
+ *
+ * @param league {League} Players read so far.
+ * @param row {CsvRow} Row of the csv file.
+ * @param out {OutputBuffer} Destination of the reports.
+ *
+ * @return {bool} False if the tree is found broken, no more rows should be
+ * added.
+ */
+template <class Keys, class Tree>
+bool process_row(League<Keys, Tree> &league, const CsvRow &row, OutputBuffer &out)
 {
-    Node *parent, *left, *right;
-    Color color;
-    Key key;
-    Data data;
-
-    /**
-     * Node constructor. Default color is red.
-     * 
-     * @param node_data {Data} Data of the node.
-     * @param node_key {Key} Key of the node. Will be used to identify the node.
-     */
-    Node(Data node_data, Key node_key, Color node_color = RED)
+    // Check if season is changed
+    if (row.season != league.season())
     {
-        data = node_data;
-        key = node_key;
-        color = node_color;
-        parent = NULL;
-        left = NULL;
-        right = NULL;
+        league.end_season(out);
+        league.start_season(row.season);
+        if (!league.valid())
+            return false;
     }
 
-    /**
-     * Compares keys of two node.
-     */
-    bool operator==(const Node &r)
-    {
-        return key == r.key;
-    }
+    league.add(row);
+    return league.valid();
+}
 
-    /**
-     * Switches color of node between red and black.
-     */
-    void toggle_color()
-    {
-        if (color == BLACK)
-            color = RED;
-        else
-            color = BLACK;
-    }
+// Rows passed at once from the parser thread to the tree thread
+static const size_t ROW_BATCH = 1024;
 
-    /**
-     * Returns whether node is black or not.
-     * 
-     * @return {bool} True if node is black
-     */
-    bool is_black()
-    {
-        return color == BLACK;
-    }
+// Text of a part parsed by one of several parser threads, a few batches of
+// rows. Parts are queued whole, so they are kept smaller than for add_rows.
+static const size_t PIPELINE_PART_BYTES = 64 * 1024;
 
-    /**
-     * Returns whether node is red or not.
-     * 
-     * @return {bool} True if node is red
-     */
-    bool is_red()
-    {
-        return color == RED;
-    }
-};
-
-struct PlayerData
+/**
+ * Parser stage of a pipelined run. Passes the rows to the tree thread in
+ * file order, in batches. An empty batch ends the input.
+ *
+ * @param reader {CsvReader} Reader at the first row.
+ * @param end {const char*} End of the csv text.
+ * @param jobs {int} Number of parser threads.
+ * @param batches {SpscQueue} Queue to the tree thread.
+ */
+void parse_rows(CsvReader reader, const char *end, int jobs, SpscQueue<vector<CsvRow> > &batches)
 {
-public:
-    string team;
-    int point;
-    int total_point;
-    int rebound;
-    int total_rebound;
-    int assist;
-    int total_assist;
-
-    PlayerData()
-    {
-    }
-
-    PlayerData(string team, int _point, int _rebound, int _assist)
-        : team(team), point(_point), total_point(_point), rebound(_rebound),
-          total_rebound(_rebound), assist(_assist), total_assist(_assist)
-    {
-    }
-
-    PlayerData(const PlayerData &v)
-    {
-        team = v.team;
-        point = v.point;
-        total_point = v.total_point;
-        rebound = v.rebound;
-        total_rebound = v.total_rebound;
-        assist = v.assist;
-        total_assist = v.total_assist;
-    }
+    vector<CsvRow> batch;
 
-    friend std::ostream &
-    operator<<(std::ostream &os, const PlayerData &val)
-    {
-        os << val.point;
-        return os;
-    }
-
-    void update(int _point, int _assist, int _rebound)
-    {
-        total_point += _point;
-        total_assist += _assist;
-        total_rebound += _rebound;
-        point = _point;
-        assist = _assist;
-        rebound = _rebound;
-    }
-};
-
-template <class Data, class Key>
-class RedBlackTree
-{
-private:
-    Node<Data, Key> *root;
-
-    /**
-     * Finds sibling of a node. Returns NULL if uncle does not exists.
-     * 
-     * @param ptr {Node*} Sibling of the node to be searched.
-     * 
-     * @return {Node*} Sibling of the given node.
-     */
-    static Node<Data, Key> *get_sibling(Node<Data, Key> *&ptr)
+    if (jobs > 1)
     {
-        Node<Data, Key> *parent = ptr->parent;
-        if (parent == NULL || parent->left == NULL || parent->right == NULL)
-            return NULL;
+        // Seasons are parsed in parallel and passed in file order
+        const char *rows_begin = reader.position();
+        ParallelReader parts(rows_begin, end - rows_begin, jobs, PIPELINE_PART_BYTES);
 
-        if (parent->left->key == ptr->key)
-            return parent->right;
-        else
-            return parent->left;
-    }
-
-    /**
-     * BST search on a subtree. Recursive
-     * 
-     * @param root {Node*} Root of the subtree.
-     * @param key {Key} Key attrubute to check on nodes.
-     * 
-     * @return {Node*} NULL or node with the given key.
-     */
-    static Node<Data, Key> *BSTsearch(Node<Data, Key> *&root, Key key)
-    {
-        if (root == NULL || root->key == key)
-        {
-            return root;
-        }
-        if (root->key < key)
+        while (parts.next(batch))
         {
-            return BSTsearch(root->right, key);
+            if (!batch.empty())
+                batches.push(batch);
         }
-        else
+    }
+    else
+    {
+        CsvRow row;
+        batch.reserve(ROW_BATCH);
+        while (reader.next(row))
         {
-            return BSTsearch(root->left, key);
+            batch.push_back(row);
+            if (batch.size() == ROW_BATCH)
+            {
+                batches.push(batch);
+                batch.clear();
+                batch.reserve(ROW_BATCH);
+            }
         }
+        if (!batch.empty())
+            batches.push(batch);
     }
 
-    /**
-     * BST insert operation on a subtree. Recursive
-     * 
-     * @param root {Node*} Root of the subtree.
-     * @param ptr {Node*} Pointer to the Node to be inserted.
-     */
-    static void BSTinsert(Node<Data, Key> *&root, Node<Data, Key> *&ptr)
+    batch.clear();
+    batches.push(batch);
+}
+
+/**
+ * Adds all rows to the league. Rows are parsed by this thread, or by
+ * options.jobs threads and applied in file order.
+ *
+ * @param league {League} Players read so far.
+ * @param reader {CsvReader} Reader at the first row.
+ * @param end {const char*} End of the csv text.
+ * @param options {Options} Command line options.
+ * @param out {OutputBuffer} Destination of the reports.
+ *
+ * @return {bool} False if the tree is found broken, the rows after it are
+ * not added.
+ */
+template <class Keys, class Tree>
+bool add_rows(League<Keys, Tree> &league, CsvReader &reader, const char *end, const Options &options,
+              OutputBuffer &out)
+{
+    if (options.jobs > 1)
     {
-        // Edge case, first node is root
-        if (root == NULL)
-        {
-            root = ptr;
-        }
+        // Seasons are parsed in parallel and applied in file order
+        const char *rows_begin = reader.position();
+        ParallelReader parts(rows_begin, end - rows_begin, options.jobs);
 
-        else if (root->key < ptr->key)
+        vector<CsvRow> rows;
+        while (parts.next(rows))
         {
-            if (root->right == NULL)
+            for (size_t i = 0; i < rows.size(); i++)
             {
-                root->right = ptr;
-                ptr->parent = root;
-                return;
+                if (!process_row(league, rows[i], out))
+                    return false;
             }
-
-            // Recursive call on right subtree
-            BSTinsert(root->right, ptr);
         }
-        else
+    }
+    else
+    {
+        CsvRow row;
+        while (reader.next(row))
         {
-            if (root->left == NULL)
-            {
-                root->left = ptr;
-                ptr->parent = root;
-                return;
-            }
-
-            // Recursive call on left subtree
-            BSTinsert(root->left, ptr);
+            if (!process_row(league, row, out))
+                return false;
         }
     }
+    return true;
+}
 
-    /**
-     * Left rotate on a subtree.
-     * 
-     * @param ptr {Node*} Root of the subtree. Will be left child of the root after rotation.
-     */
-    void rotate_left(Node<Data, Key> *&ptr)
+/**
+ * Adds all rows to the league while another thread parses them. Rows are
+ * still applied in file order.
+ *
+ * @param league {League} Players read so far.
+ * @param reader {CsvReader} Reader at the first row.
+ * @param end {const char*} End of the csv text.
+ * @param options {Options} Command line options.
+ * @param out {OutputBuffer} Destination of the reports.
+ *
+ * @return {bool} False if the tree is found broken, the rows after it are
+ * not added.
+ */
+template <class Keys, class Tree>
+bool add_rows_pipelined(League<Keys, Tree> &league, const CsvReader &reader, const char *end,
+                        const Options &options, OutputBuffer &out)
+{
+    SpscQueue<vector<CsvRow> > batches(16);
+    thread parser(parse_rows, reader, end, options.jobs, ref(batches));
+
+    // After a broken tree the batches are still taken, so the parser is
+    // not blocked on a full queue
+    bool valid = true;
+    vector<CsvRow> batch;
+    for (;;)
     {
-        Node<Data, Key> *parent = ptr->parent;
-        Node<Data, Key> *rchild = ptr->right;
+        batches.pop(batch);
+        if (batch.empty())
+            break;
 
-        if (parent != NULL)
-        {
-            if (parent->right && parent->right->key == ptr->key)
-                parent->right = rchild;
-            else
-                parent->left = rchild;
-        }
-        ptr->right = rchild->left;
-        if (ptr->right != NULL)
-            ptr->right->parent = ptr;
-        rchild->left = ptr;
-        ptr->parent = rchild;
-        rchild->parent = parent;
-
-        if (root->key == ptr->key)
-        {
-            root = rchild;
-        }
+        for (size_t i = 0; i < batch.size() && valid; i++)
+            valid = process_row(league, batch[i], out);
     }
 
-    /**
-     * Right rotate on a subtree.
-     * 
-     * @param ptr {Node*} Root of the subtree. Will be right child of the root after rotation.
-     */
-    void rotate_right(Node<Data, Key> *&ptr)
-    {
-        Node<Data, Key> *lchild = ptr->left;
-        Node<Data, Key> *parent = ptr->parent;
+    parser.join();
+    return valid;
+}
 
-        if (parent != NULL)
-        {
-            if (parent->right && parent->right->key == ptr->key)
-                parent->right = lchild;
-            else
-                parent->left = lchild;
-        }
+/**
+ * Reads the csv file and prints the tree at the end of every season.
+ *
+ * @param file {MappedFile} Opened csv file.
+ * @param keys {Keys} Maps player names to tree keys and back.
+ * @param options {Options} Command line options.
+ *
+ * @return {bool} False if the tree is found broken. The reports printed
+ * before are written, the reports at the end are not.
+ */
+template <class Tree, class Keys>
+bool run(const MappedFile &file, Keys &keys, const Options &options)
+{
+    League<Keys, Tree> league(keys, options);
+    CsvReader reader(file.data(), file.size());
+    const char *end = file.data() + file.size();
 
-        ptr->left = lchild->right;
-        if (ptr->left != NULL)
-            ptr->left->parent = ptr;
-        lchild->right = ptr;
-        ptr->parent = lchild;
-        lchild->parent = parent;
+    // Skip header line
+    reader.skip_line();
 
-        if (root->key == ptr->key)
+    if (options.load != NULL)
+    {
+        MappedFile snapshot;
+        if (!snapshot.open(options.load) || !league.load_snapshot(snapshot.data(), snapshot.size()))
         {
-            root = lchild;
+            cerr << "Snapshot cannot be loaded: " << options.load << endl;
+            exit(1);
         }
+        reader = resume_reader(reader, league.season(), league.season_row_count(), end);
     }
 
-    /**
-     * Finds route from grandparent of a node to it. Returns -1 if no route exists
-     * 
-     * @param ptr {Node*} Grandchild node.
-     * 
-     * @return {int} Route from grandparent of the given node to it.
-     * LeftLeft = 0, LeftRight = 1, RightLeft = 2, RightRight = 3,
-     */
-    static int get_route_from_grandparent(Node<Data, Key> *&ptr)
+    if (options.pipeline)
     {
-        Node<Data, Key> *parent = ptr->parent;
-        if (parent == NULL)
-        {
-            return -1;
-        }
-
-        Node<Data, Key> *grandparent = ptr->parent->parent;
-
-        if (grandparent == NULL)
-        {
-            return -1;
-        }
+        // Parsing, tree updates and report writing overlap on three threads
+        ReportWriter writer(stdout);
+        league.defer_dumps(writer);
+        OutputBuffer out(writer);
+
+        bool valid = add_rows_pipelined(league, reader, end, options, out);
+        if (valid)
+            league.finish(out);
+
+        // Everything is handed over before the writer stops
+        out.flush();
+        writer.finish();
+        return valid;
+    }
 
-        int route = 0; // Initially LeftLeft
+    // Reports so far are flushed when out is destroyed
+    OutputBuffer out(stdout);
+    if (!add_rows(league, reader, end, options, out))
+        return false;
+    league.finish(out);
+    return true;
+}
 
-        if (parent->right && parent->right->key == ptr->key)
-        {
-            route += 1;
-        }
-        if (grandparent->right && grandparent->right->key == parent->key)
-        {
-            route += 2;
-        }
+/**
+ * Runs with the tree backend given by options.backend.
+ *
+ * @param file {MappedFile} Opened csv file.
+ * @param keys {Keys} Maps player names to tree keys and back.
+ * @param options {Options} Command line options.
+ *
+ * @return {bool} False if the tree is found broken.
+ */
+template <class Keys>
+bool run_backend(const MappedFile &file, Keys &keys, const Options &options)
+{
+    typedef typename Keys::key_type Key;
 
-        return route;
+    switch (options.backend)
+    {
+    case BACKEND_COMPACT:
+        return run<CompactRedBlackTree<PlayerData, Key> >(file, keys, options);
+    case BACKEND_BTREE:
+        return run<BTree<PlayerData, Key> >(file, keys, options);
+    case BACKEND_PERSISTENT:
+        return run<PersistentTree<PlayerData, Key> >(file, keys, options);
+    default:
+        return run<RedBlackTree<PlayerData, Key> >(file, keys, options);
     }
+}
 
-    /**
-     * Maintains red-black property after insertion of a new node.
-     * 
-     * @param ptr {Node*} Pointer to the newly added node. Should be color of RED.
-     */
-    void fix_insert(Node<Data, Key> *&ptr)
-    {
-        Node<Data, Key> *parent = ptr->parent;
+int main(int argc, char *argv[])
+{
+    Options options;
 
-        // If parent is NULL or BLACK, no violation
-        if (parent == NULL || parent->color == BLACK)
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--intern") == 0)
+            options.intern_names = true;
+        else if (strcmp(argv[i], "--teams") == 0)
+            options.teams = true;
+        else if (strcmp(argv[i], "--history") == 0)
+            options.history = true;
+        else if (strcmp(argv[i], "--pipeline") == 0)
+            options.pipeline = true;
+        else if (strncmp(argv[i], "--career=", 9) == 0)
         {
-            return;
+            // A career is listed from the season histories
+            options.career = argv[i] + 9;
+            options.history = true;
         }
-
-        Node<Data, Key> *grandparent = ptr->parent->parent;
-        Node<Data, Key> *uncle = get_sibling(ptr->parent);
-
-        /* --- If uncle is NULL or BLACK --- */
-        if (uncle == NULL || uncle->color == BLACK)
+        else if (strncmp(argv[i], "--dump=", 7) == 0)
         {
-            // Route from grandparent to violating node
-            int route = get_route_from_grandparent(ptr);
-            switch (route)
+            if (!parse_dump_mode(argv[i] + 7, options.dump_mode))
             {
-            case 0:
-                // LeftLeft
-                rotate_right(grandparent);
-                grandparent->toggle_color();
-                parent->toggle_color();
-                break;
-            case 1:
-                // LeftRight
-                rotate_left(parent);
-                fix_insert(parent);
-                break;
-            case 2:
-                // RightLeft
-                rotate_right(parent);
-                fix_insert(parent);
-                break;
-            case 3:
-                // RightRight
-                rotate_left(grandparent);
-                grandparent->toggle_color();
-                parent->toggle_color();
-                break;
-            default:
-                // No grandparent or parent exists
-                break;
+                cerr << "Unknown dump mode: " << argv[i] + 7 << endl;
+                return EXIT_FAILURE;
             }
         }
-
-        /* --- If uncle is RED --- */
-        else
+        else if (strncmp(argv[i], "--top=", 6) == 0)
+            options.top = strtoul(argv[i] + 6, NULL, 10);
+        else if (strncmp(argv[i], "--prefix=", 9) == 0)
+            options.prefix = argv[i] + 9;
+        else if (strncmp(argv[i], "--retire=", 9) == 0)
+            options.retire = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--jobs=", 7) == 0)
+            options.jobs = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--save=", 7) == 0)
+            options.save = argv[i] + 7;
+        else if (strncmp(argv[i], "--load=", 7) == 0)
+            options.load = argv[i] + 7;
+        else if (strncmp(argv[i], "--verify=", 9) == 0)
+            options.verify = strtoul(argv[i] + 9, NULL, 10);
+        else if (strncmp(argv[i], "--leaders=", 10) == 0)
+            options.leaders = argv[i] + 10;
+        else if (strncmp(argv[i], "--as-of=", 8) == 0)
+            options.as_of = argv[i] + 8;
+        else if (strncmp(argv[i], "--keep-versions=", 16) == 0)
+            options.keep_versions = strtoul(argv[i] + 16, NULL, 10);
+        else if (strncmp(argv[i], "--stats=", 8) == 0)
+            options.stats = argv[i] + 8;
+        else if (strncmp(argv[i], "--backend=", 10) == 0)
         {
-            Node<Data, Key> *gparent = ptr->parent->parent;
-
-            // Recolor: parent, uncle, grandparent
-            ptr->parent->toggle_color();
-            uncle->toggle_color();
-            gparent->toggle_color();
-
-            // Recursive call on grandparent
-            fix_insert(gparent);
+            if (!parse_backend(argv[i] + 10, options.backend))
+            {
+                cerr << "Unknown backend: " << argv[i] + 10 << endl;
+                return EXIT_FAILURE;
+            }
         }
-
-        // Root is always BLACK
-        root->color = BLACK;
-    }
-
-    static void BSTpreorder_print(Node<Data, Key> *root, int depth)
-    {
-        if (root == NULL)
-            return;
-
-        for (int i = 0; i < depth; i++)
-            cout << "-";
-
-        if (root->color == BLACK)
-            cout << "(BLACK) ";
+        else if (options.filename == NULL)
+            options.filename = argv[i];
         else
-            cout << "(RED) ";
-
-        cout << root->key << endl;
-        BSTpreorder_print(root->left, depth + 1);
-        BSTpreorder_print(root->right, depth + 1);
+        {
+            cerr << "Unexpected argument: " << argv[i] << endl;
+            return EXIT_FAILURE;
+        }
     }
 
-public:
-    /**
-     * Default constructor.
-     */
-    RedBlackTree()
+    if (options.filename == NULL)
     {
-        root = NULL;
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
     }
 
-    /**
-     * Deallocates memory of the nodes.
-     */
-    ~RedBlackTree()
+    if (options.intern_names && (options.prefix != NULL || options.leaders != NULL))
     {
-        delete_subtree(root);
+        cerr << "--prefix and --leaders need players ordered by name, cannot be used with --intern" << endl;
+        return EXIT_FAILURE;
     }
 
-    /**
-     * Deallocates memory of the nodes in a subtree. Recursive
-     * 
-     * @param ptr {Node*} Root of the subtree
-     */
-    void delete_subtree(Node<Data, Key> *ptr)
+    if (options.backend != BACKEND_RB &&
+        (options.retire != 0 || options.prefix != NULL || options.verify != 0 || options.leaders != NULL))
     {
-        if (ptr == NULL)
-        {
-            return;
-        }
-
-        delete_subtree(ptr->left);
-        delete_subtree(ptr->right);
-        delete ptr;
+        cerr << "--retire, --prefix, --verify and --leaders need --backend=rb" << endl;
+        return EXIT_FAILURE;
     }
 
-    /**
-     * Search for a node in the tree.
-     * 
-     * @param key {Key} Key to be used in comparison.
-     */
-    Node<Data, Key> *search(Key key)
+    // Leaderboards keep entries, which are copied when a version is frozen
+    if (options.backend == BACKEND_PERSISTENT && options.top != 0)
     {
-        return BSTsearch(root, key);
+        cerr << "--top cannot be used with --backend=persistent" << endl;
+        return EXIT_FAILURE;
     }
 
-    /**
-     * Inserts a new node into the tree.
-     * 
-     * Rearranges colors and positions of nodes if needed.
-     * 
-     * @param node {Node*} Pointer to the node to be inserted.
-     */
-    void insert(Node<Data, Key> *node)
+    if (options.as_of != NULL && options.backend != BACKEND_PERSISTENT)
     {
-        // BST Insertion, initial color is red
-        BSTinsert(root, node);
-
-        if (root->key == node->key)
-        {
-            node->color = BLACK;
-        }
-
-        // Fix any insert violation
-        fix_insert(node);
+        cerr << "--as-of needs --backend=persistent" << endl;
+        return EXIT_FAILURE;
     }
 
-    void preorder_print()
+    // Without --as-of no version is kept anyway
+    if (options.keep_versions != 0 && options.as_of == NULL)
     {
-        BSTpreorder_print(root, 0);
+        cerr << "--keep-versions needs --as-of" << endl;
+        return EXIT_FAILURE;
     }
-};
 
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
-    {
-        cerr << "File name is not given as argument" << endl;
+    // Views are set by code embedding League, checked here as well
+    if (!check_view_options(options))
         return EXIT_FAILURE;
-    }
 
-    string filename = argv[1];
-    ifstream file;
-    file.open(filename);
+    MappedFile file;
 
-    if (!file)
+    if (!file.open(options.filename))
     {
         cerr << "File cannot be opened!";
         exit(1);
     }
 
-    RedBlackTree<PlayerData, string> tree;
-    string current_season = "";
-    int max_point = 0;
-    string max_point_name = "";
-    int max_assist = 0;
-    string max_assist_name = "";
-    int max_rebound = 0;
-    string max_rebound_name = "";
-
-    // Read header line into dummy variable
-    string line;
-    getline(file, line);
-
-    while (getline(file, line, ','))
+    bool valid;
+    if (options.intern_names)
     {
-        string season = line;
-
-        string name;
-        getline(file, name, ',');
-
-        string team;
-        getline(file, team, ',');
-
-        int rebound, assist, point;
-
-        getline(file, line, ',');
-        rebound = stoi(line);
-
-        getline(file, line, ',');
-        assist = stoi(line);
-
-        getline(file, line, '\n');
-        point = stoi(line);
-
-        // Check if season is changed
-        if (season != current_season)
-        {
-            if (current_season.length() != 0)
-            {
-                // Print the situation
-                cout << "End of the " << current_season << " Season" << endl;
-
-                // Print max's
-                cout << "Max Points: " << max_point << " - Player Name: " << max_point_name << endl;
-                cout << "Max Assists: " << max_assist << " - Player Name: " << max_assist_name << endl;
-                cout << "Max Rebs: " << max_rebound << " - Player Name: " << max_rebound_name << endl;
-            }
-
-            tree.preorder_print();
-
-            // Update current season
-            current_season = season;
-        }
-
-        // Search for the player in the tree
-        Node<PlayerData, string> *node = tree.search(name);
-
-        // Total scores of player
-        int t_point, t_assist, t_rebound;
-
-        if (node == NULL)
-        {
-            // User is not found in the tree, will be inserted
-            PlayerData player_data(team, point, rebound, assist);
-            node = new Node<PlayerData, string>(player_data, name);
-            tree.insert(node);
-            t_point = point;
-            t_assist = assist;
-            t_rebound = rebound;
-        }
-        else
-        {
-            // User is found in the tree, will be updated
-            node->data.update(point, assist, rebound);
-            t_point = node->data.total_point;
-            t_assist = node->data.total_assist;
-            t_rebound = node->data.total_rebound;
-        }
-
-        // Update max point, rebound and assit
-        if (t_assist > max_assist)
-        {
-            max_assist = t_assist;
-            max_assist_name = name;
-        }
-        if (t_point > max_point)
-        {
-            max_point = t_point;
-            max_point_name = name;
-        }
-        if (t_rebound > max_rebound)
-        {
-            max_rebound = t_rebound;
-            max_rebound_name = name;
-        }
+        InternedNameKeys keys;
+        valid = run_backend(file, keys, options);
+    }
+    else
+    {
+        NameKeys keys;
+        valid = run_backend(file, keys, options);
     }
 
-    // Print last season data
-    cout << "End of the " << current_season << " Season" << endl;
-
-    // Print max's
-    cout << "Max Points: " << max_point << " - Player Name: " << max_point_name << endl;
-    cout << "Max Assists: " << max_assist << " - Player Name: " << max_assist_name << endl;
-    cout << "Max Rebs: " << max_rebound << " - Player Name: " << max_rebound_name << endl;
-
-    tree.preorder_print();
-
-    file.close();
-    return EXIT_SUCCESS;
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
 }
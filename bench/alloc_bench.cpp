@@ -0,0 +1,211 @@
+/**
+ * Counts heap allocations made while the rows of a csv file are added to a
+ * player tree, per row, for every backend.
+ *
+ * A new player needs one allocation for its name if the name is longer than
+ * the small string buffer of std::string, and nothing else: nodes and
+ * records come from pool slabs or chunks and data is moved into the node.
+ * Every other allocation of a player is a redundant copy. Two call styles
+ * are measured:
+ *   - copy: key and data are built first and passed as lvalues, so the tree
+ *     copies both into the node. Measured on RedBlackTree, as a reference of
+ *     what redundant copies look like.
+ *   - in place: the name field is passed as a FieldView and the data as a
+ *     temporary, as League does, so the key is built inside the node.
+ *     Measured on every backend.
+ *
+ * Redundant allocations are counted per row for both styles, as the copy
+ * style builds a key on every row and not only for new players. Exits with
+ * failure if an in place run makes more than MAX_REDUNDANT redundant
+ * allocations per row. Copies of short names do not allocate, so the check
+ * needs a file with long names, e.g. from gen_csv --name-dist=long.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/alloc_bench.cpp -o alloc_bench
+ * Run:     ./alloc_bench euroleague.csv
+ */
+#include <iostream>
+#include <cstdlib> // malloc, free
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/BTree.h"
+#include "../include/CompactTree.h"
+#include "../include/CsvReader.h"
+#include "../include/PersistentTree.h"
+#include "../include/PlayerData.h"
+#include "../include/RedBlackTree.h"
+
+using namespace std;
+
+// Allocations since the start, and those at least SLAB_BYTES large
+static size_t allocations = 0;
+static size_t slab_allocations = 0;
+
+// Pool slabs and chunks hold at least 64 nodes or records of more than 64
+// bytes, the other allocations of a tree are smaller
+static const size_t SLAB_BYTES = 4096;
+
+// Besides the slabs, the pools keep small lists of them which grow a few
+// times. Redundant copies of long names make far more than this per row.
+static const double MAX_REDUNDANT = 0.05;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (size >= SLAB_BYTES)
+        slab_allocations++;
+
+    void *ptr = malloc(size != 0 ? size : 1);
+    if (ptr == NULL)
+        throw bad_alloc();
+    return ptr;
+}
+
+// Kept out of line, or GCC sees memory from operator new passed to free
+// where both are inlined and warns of a mismatch
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+/**
+ * Allocation counts of one run.
+ */
+struct AllocCount
+{
+    size_t players;
+    size_t long_names; // Names which do not fit in the small string buffer
+    size_t allocations;
+    size_t slabs;
+};
+
+/**
+ * Adds all rows to a new tree. Keys and data are built before the call and
+ * passed as lvalues.
+ */
+static AllocCount add_copied(const vector<CsvRow> &rows)
+{
+    RedBlackTree<PlayerData, string> tree;
+    AllocCount count = AllocCount();
+    size_t small_capacity = string().capacity();
+
+    size_t start = allocations;
+    size_t slab_start = slab_allocations;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const CsvRow &row = rows[i];
+        string name = row.name.str();
+        PlayerData data(0, row.point, row.rebound, row.assist);
+
+        pair<Node<PlayerData, string> *, bool> result = tree.upsert(name, data);
+        if (result.second)
+        {
+            count.players++;
+            if (row.name.length > small_capacity)
+                count.long_names++;
+        }
+        else
+            result.first->data.update(row.point, row.assist, row.rebound);
+    }
+    count.allocations = allocations - start;
+    count.slabs = slab_allocations - slab_start;
+    return count;
+}
+
+/**
+ * Adds all rows to a new tree the way League does: the name field is passed
+ * as is and the data as a temporary.
+ */
+template <class Tree>
+static AllocCount add_in_place(const vector<CsvRow> &rows)
+{
+    Tree tree;
+    AllocCount count = AllocCount();
+    size_t small_capacity = string().capacity();
+
+    size_t start = allocations;
+    size_t slab_start = slab_allocations;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const CsvRow &row = rows[i];
+        pair<typename Tree::entry_type *, bool> result =
+            tree.upsert(row.name, PlayerData(0, row.point, row.rebound, row.assist));
+        if (result.second)
+        {
+            count.players++;
+            if (row.name.length > small_capacity)
+                count.long_names++;
+        }
+        else
+            result.first->data.update(row.point, row.assist, row.rebound);
+    }
+    count.allocations = allocations - start;
+    count.slabs = slab_allocations - slab_start;
+    return count;
+}
+
+/**
+ * Prints a line of the result table. Allocations other than the slabs and
+ * the names are redundant copies.
+ *
+ * @return {double} Redundant allocations per row.
+ */
+static double print_count(const char *title, const AllocCount &count, size_t rows)
+{
+    size_t redundant = count.allocations - count.slabs - count.long_names;
+    double per_row = rows != 0 ? (double)redundant / rows : 0;
+    cout << title << count.allocations << " allocations for " << rows << " rows, "
+         << count.players << " players (" << count.slabs << " slabs, " << count.long_names
+         << " long names), " << per_row << " redundant per row" << endl;
+    return per_row;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1]))
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<CsvRow> rows;
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    CsvRow row;
+    while (reader.next(row))
+        rows.push_back(row);
+
+    print_count("rb copy:             ", add_copied(rows), rows.size());
+
+    // Every backend with the call style of League
+    double worst = 0;
+    double redundant[] = {
+        print_count("rb in place:         ", add_in_place<RedBlackTree<PlayerData, string> >(rows), rows.size()),
+        print_count("compact in place:    ", add_in_place<CompactRedBlackTree<PlayerData, string> >(rows), rows.size()),
+        print_count("btree in place:      ", add_in_place<BTree<PlayerData, string> >(rows), rows.size()),
+        print_count("persistent in place: ", add_in_place<PersistentTree<PlayerData, string> >(rows), rows.size()),
+    };
+    for (size_t i = 0; i < sizeof(redundant) / sizeof(redundant[0]); i++)
+    {
+        if (redundant[i] > worst)
+            worst = redundant[i];
+    }
+
+    if (worst > MAX_REDUNDANT)
+    {
+        cerr << "Redundant allocations: " << worst << " per row, at most " << MAX_REDUNDANT << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+/**
+ * Writes a synthetic csv file with the schema of euroleague.csv
+ * (Season,Name,Team,Rebound,Assist,Point). The same options always give the
+ * same file.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/gen_csv.cpp -o gen_csv
+ * Run:     ./gen_csv [--rows=N] [--season-rows=N] [--roster=N] [--churn=F]
+ *                    [--name-min=N] [--name-max=N] [--name-dist=uniform|long]
+ *                    [--seed=N] output.csv
+ *
+ * Every season has season-rows rows, drawn from a roster of players. At the
+ * start of every season a churn fraction of the roster is replaced with new
+ * players. Name lengths are uniform between name-min and name-max, or
+ * mostly short with a geometric tail up to name-max for "long".
+ */
+#include <iostream>
+#include <cstdio>  // fopen, snprintf
+#include <cstdlib> // strtoull, atof
+#include <cstring> // strcmp, strncmp
+#include <string>
+#include <vector>
+
+#include "../include/OutputBuffer.h"
+
+using namespace std;
+
+/**
+ * Generator options.
+ */
+struct GenOptions
+{
+    unsigned long long rows;
+    unsigned int season_rows;
+    unsigned int roster;
+    double churn;
+    unsigned int name_min;
+    unsigned int name_max;
+    bool long_tail;
+    unsigned long long seed;
+    const char *output;
+
+    GenOptions()
+        : rows(10000), season_rows(350), roster(300), churn(0.2), name_min(8), name_max(20),
+          long_tail(false), seed(1), output(NULL)
+    {
+    }
+};
+
+/**
+ * Deterministic pseudo random numbers (xorshift64*).
+ */
+class Random
+{
+private:
+    unsigned long long state;
+
+public:
+    Random(unsigned long long seed) : state(seed * 2685821657736338717ull + 1)
+    {
+    }
+
+    unsigned long long next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+
+    /**
+     * Returns a number in [0, n).
+     */
+    unsigned int below(unsigned int n)
+    {
+        return (unsigned int)((next() >> 32) % n);
+    }
+};
+
+/**
+ * Builds a unique name for a player id. The id is encoded in the leading
+ * capital letters, the rest is filled with random lowercase letters up to
+ * the length, with a space in the middle.
+ */
+static string player_name(unsigned long long id, unsigned int length, Random &random)
+{
+    static const char vowels[] = "aeiou";
+    static const char consonants[] = "bcdfghjklmnprstvz";
+
+    string name;
+    do
+    {
+        name += (char)('A' + id % 26);
+        id /= 26;
+    } while (id != 0);
+
+    // First and last name, if there is room for both
+    size_t space = 0;
+    if (length >= name.length() + 3)
+        space = name.length() + (length - name.length()) / 2;
+
+    while (name.length() < length)
+    {
+        if (name.length() == space)
+            name += ' ';
+        else if (name.length() % 2 == 0)
+            name += consonants[random.below(sizeof(consonants) - 1)];
+        else
+            name += vowels[random.below(sizeof(vowels) - 1)];
+    }
+    return name;
+}
+
+static unsigned int name_length(const GenOptions &options, Random &random)
+{
+    unsigned int span = options.name_max - options.name_min + 1;
+    if (!options.long_tail)
+        return options.name_min + random.below(span);
+
+    // Each extra character with probability 1/2
+    unsigned int length = options.name_min;
+    while (length < options.name_max && random.below(2) == 0)
+        length++;
+    return length;
+}
+
+static bool parse_options(int argc, char *argv[], GenOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--rows=", 7) == 0)
+            options.rows = strtoull(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--season-rows=", 14) == 0)
+            options.season_rows = strtoul(argv[i] + 14, NULL, 10);
+        else if (strncmp(argv[i], "--roster=", 9) == 0)
+            options.roster = strtoul(argv[i] + 9, NULL, 10);
+        else if (strncmp(argv[i], "--churn=", 8) == 0)
+            options.churn = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--name-min=", 11) == 0)
+            options.name_min = strtoul(argv[i] + 11, NULL, 10);
+        else if (strncmp(argv[i], "--name-max=", 11) == 0)
+            options.name_max = strtoul(argv[i] + 11, NULL, 10);
+        else if (strcmp(argv[i], "--name-dist=uniform") == 0)
+            options.long_tail = false;
+        else if (strcmp(argv[i], "--name-dist=long") == 0)
+            options.long_tail = true;
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+            options.seed = strtoull(argv[i] + 7, NULL, 10);
+        else if (options.output == NULL)
+            options.output = argv[i];
+        else
+        {
+            cerr << "Unexpected argument: " << argv[i] << endl;
+            return false;
+        }
+    }
+
+    if (options.output == NULL)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return false;
+    }
+    if (options.season_rows == 0 || options.roster == 0 || options.name_min == 0 ||
+        options.name_max < options.name_min || options.churn < 0 || options.churn > 1)
+    {
+        cerr << "Invalid options" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes all rows to a file.
+ */
+static void generate(const GenOptions &options, FILE *file)
+{
+    static const char *teams[] = {"ATH", "BAR", "BER", "CSK", "EFS", "FEN", "MAD", "MAC",
+                                  "MIL", "MON", "MUN", "OLY", "PAN", "PAR", "RED", "ZAL"};
+
+    Random random(options.seed);
+    OutputBuffer out(file);
+    out << "Season,Name,Team,Rebound,Assist,Point\n";
+
+    // Names of the players in the roster
+    vector<string> roster(options.roster);
+    unsigned long long next_id = 0;
+    for (unsigned int i = 0; i < options.roster; i++, next_id++)
+        roster[i] = player_name(next_id, name_length(options, random), random);
+
+    unsigned int replaced = (unsigned int)(options.churn * options.roster);
+    char season[32];
+
+    for (unsigned long long row = 0, year = 2000; row < options.rows; year++)
+    {
+        if (row != 0)
+        {
+            for (unsigned int i = 0; i < replaced; i++, next_id++)
+                roster[random.below(options.roster)] = player_name(next_id, name_length(options, random), random);
+        }
+
+        snprintf(season, sizeof(season), "%llu-%llu", year, year + 1);
+        for (unsigned int i = 0; i < options.season_rows && row < options.rows; i++, row++)
+        {
+            out << season << ',' << roster[random.below(options.roster)] << ','
+                << teams[random.below(16)] << ',' << (int)random.below(300) << ','
+                << (int)random.below(150) << ',' << (int)random.below(400) << '\n';
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    GenOptions options;
+    if (!parse_options(argc, argv, options))
+        return EXIT_FAILURE;
+
+    FILE *file = fopen(options.output, "wb");
+    if (file == NULL)
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    generate(options, file);
+
+    if (ferror(file) || fclose(file) != 0)
+    {
+        cerr << "File cannot be written!" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/**
+ * Compares lookups in RedBlackTree, CompactRedBlackTree and BTree with
+ * integer (interned) keys.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/layout_bench.cpp -o layout_bench
+ * Run:     ./layout_bench [players] [lookups]
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdlib> // atoi
+#include <vector>
+
+#include "../include/BTree.h"
+#include "../include/CompactTree.h"
+#include "../include/PlayerData.h"
+#include "../include/RedBlackTree.h"
+
+using namespace std;
+
+/**
+ * Deterministic pseudo random numbers (xorshift).
+ */
+static unsigned int next_random(unsigned int &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * Looks up every key and returns elapsed nanoseconds per lookup.
+ */
+template <class Tree>
+static double time_lookups(Tree &tree, const vector<unsigned int> &keys, long long &checksum)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        checksum += tree.search(keys[i])->data.total_point;
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+
+    return chrono::duration_cast<chrono::nanoseconds>(stop - start).count() / (double)keys.size();
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int players = argc > 1 ? atoi(argv[1]) : 1000000;
+    unsigned int lookups = argc > 2 ? atoi(argv[2]) : 5000000;
+    unsigned int state = 2463534242u;
+
+    // Interned ids are dense, insert them in random order
+    vector<unsigned int> order(players);
+    for (unsigned int i = 0; i < players; i++)
+        order[i] = i;
+    for (unsigned int i = players; i > 1; i--)
+        swap(order[i - 1], order[next_random(state) % i]);
+
+    RedBlackTree<PlayerData, unsigned int> tree;
+    CompactRedBlackTree<PlayerData, unsigned int> compact;
+    BTree<PlayerData, unsigned int> btree;
+    for (unsigned int i = 0; i < players; i++)
+    {
+        PlayerData data(0, order[i] % 100, 0, 0);
+        tree.upsert(order[i], data);
+        compact.upsert(order[i], data);
+        btree.upsert(order[i], data);
+    }
+
+    vector<unsigned int> keys(lookups);
+    for (unsigned int i = 0; i < lookups; i++)
+        keys[i] = next_random(state) % players;
+
+    long long checksum = 0;
+    double pointer_ns = time_lookups(tree, keys, checksum);
+    double compact_ns = time_lookups(compact, keys, checksum);
+    double btree_ns = time_lookups(btree, keys, checksum);
+
+    cout << "Players: " << players << ", lookups: " << lookups << endl;
+    cout << "RedBlackTree:        " << sizeof(Node<PlayerData, unsigned int>)
+         << " bytes per node, " << pointer_ns << " ns per lookup" << endl;
+    cout << "CompactRedBlackTree: " << 4 * sizeof(unsigned int) << " hot + "
+         << sizeof(CompactRedBlackTree<PlayerData, unsigned int>::Record)
+         << " cold bytes per node, " << compact_ns << " ns per lookup" << endl;
+    cout << "BTree:               " << btree_ns << " ns per lookup" << endl;
+    cout << "(checksum " << checksum << ")" << endl;
+
+    return EXIT_SUCCESS;
+}
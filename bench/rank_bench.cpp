@@ -0,0 +1,186 @@
+/**
+ * Checks rank and select of RedBlackTree against a sorted reference while
+ * keys are inserted and erased at random, and times them against walking
+ * the iterator.
+ *
+ * After every batch of changes, for every position i:
+ *   - select(i) has the i-th key of the reference and rank(select(i)) == i,
+ *   - rank of an absent key is the number of smaller keys in the reference,
+ *   - select(size()) is NULL.
+ * Exits with failure at the first mismatch.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/rank_bench.cpp -o rank_bench
+ * Run:     ./rank_bench 200000 [seed]
+ */
+#include <iostream>
+#include <algorithm> // lower_bound
+#include <chrono>
+#include <cstdlib> // strtoul
+#include <set>
+#include <vector>
+
+#include "../include/RedBlackTree.h"
+
+using namespace std;
+
+/**
+ * Deterministic pseudo random numbers (xorshift64*).
+ */
+class Random
+{
+private:
+    unsigned long long state;
+
+public:
+    Random(unsigned long long seed) : state(seed * 2685821657736338717ull + 1)
+    {
+    }
+
+    unsigned long long next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+
+    /**
+     * Returns a number in [0, n).
+     */
+    unsigned int below(unsigned int n)
+    {
+        return (unsigned int)((next() >> 32) % n);
+    }
+};
+
+typedef RedBlackTree<int, unsigned int> Tree;
+
+/**
+ * Compares every position of the tree with the sorted reference. Keys in
+ * the tree are even, so key + 1 is never in it.
+ *
+ * @return {bool} False and prints the position at the first mismatch.
+ */
+static bool check(const Tree &tree, const vector<unsigned int> &sorted)
+{
+    if (tree.size() != sorted.size())
+    {
+        cerr << "size " << tree.size() << " != " << sorted.size() << endl;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < sorted.size(); i++)
+    {
+        const Node<int, unsigned int> *node = tree.select(i);
+        if (node == NULL || node->key != sorted[i])
+        {
+            cerr << "select(" << i << ") is not " << sorted[i] << endl;
+            return false;
+        }
+        if (tree.rank(node->key) != i)
+        {
+            cerr << "rank(select(" << i << ")) = " << tree.rank(node->key) << endl;
+            return false;
+        }
+
+        unsigned int absent = sorted[i] + 1;
+        unsigned int expected =
+            (unsigned int)(lower_bound(sorted.begin(), sorted.end(), absent) - sorted.begin());
+        if (tree.rank(absent) != expected)
+        {
+            cerr << "rank(" << absent << ") = " << tree.rank(absent) << ", expected " << expected << endl;
+            return false;
+        }
+    }
+
+    if (tree.select((unsigned int)sorted.size()) != NULL)
+    {
+        cerr << "select(size()) is not NULL" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns elapsed nanoseconds per position of select(i) at count evenly
+ * spaced positions, or of advancing an iterator from begin() to them if
+ * walk is set.
+ */
+static double time_positions(Tree &tree, unsigned int count, bool walk, unsigned long long &checksum)
+{
+    unsigned int step = (unsigned int)(tree.size() / count);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int index = i * step;
+        if (walk)
+        {
+            Tree::iterator it = tree.begin();
+            for (unsigned int j = 0; j < index; j++)
+                ++it;
+            checksum += it->key;
+        }
+        else
+            checksum += tree.select(index)->key;
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(stop - start).count() / (double)count;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int operations = argc > 1 ? (unsigned int)strtoul(argv[1], NULL, 10) : 200000;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    if (operations == 0)
+    {
+        cerr << "Number of operations must be positive" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Random random(seed);
+    Tree tree;
+    set<unsigned int> reference;
+
+    // Keys repeat often enough that erases hit, and batches grow so that
+    // the checks stay O(n) per batch
+    unsigned int key_range = operations;
+    unsigned int done = 0, batch = 16, checks = 0;
+    while (done < operations)
+    {
+        for (unsigned int i = 0; i < batch && done < operations; i++, done++)
+        {
+            unsigned int key = 2 * random.below(key_range);
+            if (random.below(3) == 0)
+            {
+                tree.erase(key);
+                reference.erase(key);
+            }
+            else
+            {
+                tree.upsert(key, 0);
+                reference.insert(key);
+            }
+        }
+        batch *= 2;
+
+        vector<unsigned int> sorted(reference.begin(), reference.end());
+        if (!check(tree, sorted) || !tree.verify().valid)
+        {
+            cerr << "Mismatch after " << done << " operations, seed " << seed << endl;
+            return EXIT_FAILURE;
+        }
+        checks++;
+    }
+    cout << "rank/select match the reference after " << checks << " batches, "
+         << tree.size() << " keys" << endl;
+
+    unsigned long long checksum = 0;
+    unsigned int count = 1000;
+    if (tree.size() >= count)
+    {
+        cout << "select:  " << time_positions(tree, count, false, checksum) << " ns per position" << endl;
+        cout << "iterate: " << time_positions(tree, count, true, checksum) << " ns per position" << endl;
+        cout << "(checksum " << checksum << ")" << endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/**
+ * Reads player totals from several threads while the loader adds rows.
+ * Readers use the views published at the end of every season, and every
+ * publish_rows rows if it is given, and never wait for the loader.
+ *
+ * Views are frozen versions of a PersistentTree, so the load is timed with
+ * the default tree, with the persistent tree and with the persistent tree
+ * publishing views. Versions no view refers to are dropped, so the peak
+ * memory of the loads is printed too: with views it should stay close to
+ * the default tree, not grow with the number of seasons. Exits with failure
+ * if it is more than MAX_VIEW_MEMORY times as much and VIEW_SLACK_MB, or if
+ * a reader sees inconsistent data.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 -pthread bench/reader_bench.cpp -o reader_bench
+ * Run:     ./reader_bench euroleague.csv [readers] [publish_rows]
+ */
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>  // fopen
+#include <cstdlib> // atoi
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h> // getrusage
+
+#include "../include/CsvReader.h"
+#include "../include/League.h"
+#include "../include/OutputBuffer.h"
+#include "../include/PlayerKeys.h"
+
+using namespace std;
+
+/**
+ * Looks players up in the latest view until the loader is done.
+ */
+static void read_players(const ReadViewSlot &slot, const vector<string> &names,
+                         const atomic<bool> &done, long long &reads, bool &consistent)
+{
+    int last_season = -1;
+    size_t i = 0;
+
+    while (!done.load())
+    {
+        shared_ptr<const ReadView> view = slot.acquire();
+        if (!view)
+        {
+            this_thread::yield();
+            continue;
+        }
+
+        // Views of later seasons are published in order
+        if (view->season_index() < last_season)
+            consistent = false;
+        last_season = view->season_index();
+
+        for (int k = 0; k < 1000; k++, i++)
+        {
+            const PlayerData *data = view->search(names[i % names.size()]);
+            if (data != NULL && data->total_point < data->point)
+                consistent = false;
+            reads++;
+        }
+    }
+}
+
+typedef PersistentTree<PlayerData, string> ViewTree;
+
+// Peak memory of the load with views against the load with the default
+// tree, besides VIEW_SLACK_MB for the reader threads and the views in use
+static const double MAX_VIEW_MEMORY = 2.0;
+static const double VIEW_SLACK_MB = 16.0;
+
+/**
+ * Returns peak resident memory of the process so far in MB.
+ */
+static double peak_mb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+/**
+ * Adds all rows of the file to a league and returns elapsed milliseconds.
+ */
+template <class Tree>
+static double load(League<NameKeys, Tree> &league, const MappedFile &file, FILE *null_file)
+{
+    OutputBuffer out(null_file);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+
+    CsvRow row;
+    while (reader.next(row))
+    {
+        if (row.season != league.season())
+        {
+            league.end_season(out);
+            league.start_season(row.season);
+        }
+        league.add(row);
+    }
+    league.finish(out);
+
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::microseconds>(stop - start).count() / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
+    }
+    int reader_count = argc > 2 ? atoi(argv[2]) : 4;
+    unsigned int publish_rows = argc > 3 ? (unsigned int)atoi(argv[3]) : 0;
+
+    MappedFile file;
+    if (!file.open(argv[1]))
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Names to look up
+    vector<string> names;
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    CsvRow row;
+    while (reader.next(row))
+        names.push_back(row.name.str());
+
+    FILE *null_file = fopen("/dev/null", "w");
+    Options options;
+    options.dump_mode = DUMP_OFF;
+
+    // Leagues are destroyed after their load, so each peak is at least the
+    // one before
+    double plain_ms, persistent_ms;
+    {
+        NameKeys plain_keys;
+        League<NameKeys> plain(plain_keys, options);
+        plain_ms = load(plain, file, null_file);
+    }
+    double plain_mb = peak_mb();
+
+    {
+        NameKeys persistent_keys;
+        League<NameKeys, ViewTree> persistent(persistent_keys, options);
+        persistent_ms = load(persistent, file, null_file);
+    }
+    double persistent_mb = peak_mb();
+
+    Options view_options = options;
+    view_options.backend = BACKEND_PERSISTENT;
+    view_options.publish_views = true;
+    view_options.publish_rows = publish_rows;
+    if (!check_view_options(view_options))
+        return EXIT_FAILURE;
+
+    NameKeys keys;
+    League<NameKeys, ViewTree> league(keys, view_options);
+    atomic<bool> done(false);
+    double view_ms = 0;
+
+    vector<long long> reads(reader_count, 0);
+    vector<char> consistent(reader_count, 1);
+    vector<thread> readers;
+
+    for (int i = 0; i < reader_count; i++)
+    {
+        readers.push_back(thread([&, i]() {
+            bool ok = true;
+            read_players(league.read_views(), names, done, reads[i], ok);
+            consistent[i] = ok;
+        }));
+    }
+
+    thread loader([&]() {
+        view_ms = load(league, file, null_file);
+        done = true;
+    });
+
+    loader.join();
+    for (int i = 0; i < reader_count; i++)
+        readers[i].join();
+    double view_mb = peak_mb();
+
+    fclose(null_file);
+
+    long long total_reads = 0;
+    bool all_consistent = true;
+    for (int i = 0; i < reader_count; i++)
+    {
+        total_reads += reads[i];
+        all_consistent = all_consistent && consistent[i];
+    }
+
+    bool bounded = view_mb <= MAX_VIEW_MEMORY * plain_mb + VIEW_SLACK_MB;
+
+    cout << "Load without views: " << plain_ms << " ms, peak " << plain_mb << " MB" << endl;
+    cout << "Load on the persistent tree without views: " << persistent_ms << " ms, peak "
+         << persistent_mb << " MB" << endl;
+    cout << "Load with views";
+    if (publish_rows != 0)
+        cout << " every " << publish_rows << " rows";
+    cout << " and " << reader_count << " readers: " << view_ms << " ms, peak " << view_mb << " MB"
+         << (bounded ? "" : " (UNBOUNDED)") << endl;
+    cout << "Lookups during load: " << total_reads << (all_consistent ? "" : " (INCONSISTENT)") << endl;
+
+    return all_consistent && bounded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
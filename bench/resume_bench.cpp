@@ -0,0 +1,196 @@
+/**
+ * Checks that a run resumed from a snapshot prints the same reports as a
+ * full run, for input cut within a season and at the end of a season.
+ *
+ * For every cut, the rows before it are added with the snapshot written at
+ * the end of every season and of the input. A second run loads the
+ * snapshot and reads the whole file from where the snapshot stopped. Its
+ * output must be the end of the output of a full run, from the report of
+ * the season that was cut. Trees are not dumped, as the shape of a loaded
+ * tree may differ. Exits with failure at the first mismatch.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 -pthread bench/resume_bench.cpp -o resume_bench
+ * Run:     ./resume_bench euroleague.csv [cuts]
+ */
+#include <iostream>
+#include <cstdio>  // tmpfile, remove
+#include <cstdlib> // atoi
+#include <string>
+#include <vector>
+
+#include "../include/CsvReader.h"
+#include "../include/League.h"
+#include "../include/OutputBuffer.h"
+#include "../include/PlayerKeys.h"
+
+using namespace std;
+
+static const char *SNAPSHOT_PATH = "resume_bench.snapshot";
+
+/**
+ * Adds the rows of a reader to a league and prints the reports.
+ */
+static void add_rows(League<NameKeys> &league, CsvReader reader, OutputBuffer &out)
+{
+    CsvRow row;
+    while (reader.next(row))
+    {
+        if (row.season != league.season())
+        {
+            league.end_season(out);
+            league.start_season(row.season);
+        }
+        league.add(row);
+    }
+    league.finish(out);
+}
+
+/**
+ * Returns everything written to a temporary file.
+ */
+static string read_back(FILE *file)
+{
+    string text;
+    char buffer[1 << 16];
+    size_t length;
+
+    rewind(file);
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) != 0)
+        text.append(buffer, length);
+    fclose(file);
+    return text;
+}
+
+/**
+ * Runs the league over the rows before cut, then resumes from its snapshot
+ * over the whole file.
+ *
+ * @return {string} Output of the resumed run, empty if the snapshot cannot
+ * be loaded.
+ */
+static string resume_output(const MappedFile &file, const char *cut, const Options &options)
+{
+    FILE *null_file = fopen("/dev/null", "w");
+    {
+        Options save_options = options;
+        save_options.save = SNAPSHOT_PATH;
+        NameKeys keys;
+        League<NameKeys> league(keys, save_options);
+        OutputBuffer out(null_file);
+
+        CsvReader reader(file.data(), cut - file.data());
+        reader.skip_line();
+        add_rows(league, reader, out);
+    }
+    fclose(null_file);
+
+    MappedFile snapshot;
+    NameKeys keys;
+    League<NameKeys> league(keys, options);
+    if (!snapshot.open(SNAPSHOT_PATH) || !league.load_snapshot(snapshot.data(), snapshot.size()))
+        return string();
+
+    const char *end = file.data() + file.size();
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    reader = resume_reader(reader, league.season(), league.season_row_count(), end);
+
+    FILE *output = tmpfile();
+    {
+        OutputBuffer out(output);
+        add_rows(league, reader, out);
+    }
+    return read_back(output);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
+    }
+    int cut_count = argc > 2 ? atoi(argv[2]) : 20;
+
+    MappedFile file;
+    if (!file.open(argv[1]))
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // End of every row, and whether a new season starts after it
+    vector<const char *> row_ends;
+    vector<bool> season_ends;
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    CsvRow row, previous;
+    while (reader.next(row))
+    {
+        if (!row_ends.empty())
+            season_ends.push_back(row.season != previous.season);
+        row_ends.push_back(reader.position());
+        previous = row;
+    }
+    season_ends.push_back(true);
+
+    if (row_ends.size() < 2 || cut_count <= 0)
+    {
+        cerr << "File has too few rows" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // The tree of a loaded snapshot is built balanced, so its shape is not
+    // compared
+    Options options;
+    options.dump_mode = DUMP_OFF;
+    options.teams = true;
+    options.history = true;
+
+    FILE *output = tmpfile();
+    {
+        NameKeys keys;
+        League<NameKeys> league(keys, options);
+        OutputBuffer out(output);
+        reader = CsvReader(file.data(), file.size());
+        reader.skip_line();
+        add_rows(league, reader, out);
+    }
+    string full = read_back(output);
+
+    // Cuts are spread over the file, each also moved to the next end of a
+    // season
+    int checked = 0, within = 0;
+    for (int i = 1; i <= cut_count; i++)
+    {
+        size_t rows = row_ends.size() * i / (cut_count + 1);
+        size_t season_end = rows;
+        while (!season_ends[season_end - 1])
+            season_end++;
+
+        size_t cuts[] = {rows, season_end};
+        for (int k = 0; k < 2; k++)
+        {
+            if (k == 1 && season_end == rows)
+                continue;
+
+            string resumed = resume_output(file, row_ends[cuts[k] - 1], options);
+            if (resumed.empty() || resumed.size() > full.size() ||
+                full.compare(full.size() - resumed.size(), resumed.size(), resumed) != 0 ||
+                resumed.compare(0, 11, "End of the ") != 0)
+            {
+                cerr << "Resumed output differs after a cut at row " << cuts[k] << endl;
+                remove(SNAPSHOT_PATH);
+                return EXIT_FAILURE;
+            }
+            checked++;
+            if (!season_ends[cuts[k] - 1])
+                within++;
+        }
+    }
+    remove(SNAPSHOT_PATH);
+
+    cout << "Resumed output matches the full run for " << checked << " cuts, "
+         << within << " of them within a season" << endl;
+    return EXIT_SUCCESS;
+}
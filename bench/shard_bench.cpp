@@ -0,0 +1,163 @@
+/**
+ * Applies the rows of a csv file to a single RedBlackTree and to a
+ * ShardedTree from several threads, with shard locks and with shards owned
+ * by threads. Checks that all runs give the same totals, and times the
+ * sorted merge of the shards.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 -pthread bench/shard_bench.cpp -o shard_bench
+ * Run:     ./shard_bench euroleague.csv [threads] [shards]
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdlib> // atoi
+#include <thread>
+#include <vector>
+
+#include "../include/CsvReader.h"
+#include "../include/PlayerData.h"
+#include "../include/RedBlackTree.h"
+#include "../include/ShardedTree.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double elapsed_ms(Clock::time_point start)
+{
+    return chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count() / 1000.0;
+}
+
+/**
+ * Adds a row to the totals of its player.
+ */
+struct AddRow
+{
+    const CsvRow &row;
+
+    AddRow(const CsvRow &row) : row(row)
+    {
+    }
+
+    void operator()(Node<PlayerData, string> *node, bool inserted)
+    {
+        if (!inserted)
+            node->data.update(row.point, row.assist, row.rebound);
+    }
+};
+
+/**
+ * Sums the totals in visiting order, so both the order and the totals of
+ * two trees can be compared.
+ */
+struct Checksum
+{
+    long long value;
+
+    Checksum() : value(0)
+    {
+    }
+
+    void operator()(const Node<PlayerData, string> *node)
+    {
+        value = value * 31 + node->data.total_point + node->data.total_assist + node->data.total_rebound;
+        value += node->key.length();
+    }
+};
+
+static PlayerData row_data(const CsvRow &row)
+{
+    return PlayerData(0, row.point, row.rebound, row.assist);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
+    }
+    int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    int shard_count = argc > 3 ? atoi(argv[3]) : 4 * thread_count;
+
+    MappedFile file;
+    if (!file.open(argv[1]))
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<CsvRow> rows;
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    CsvRow row;
+    while (reader.next(row))
+        rows.push_back(row);
+
+    // Single tree
+    Clock::time_point start = Clock::now();
+    RedBlackTree<PlayerData, string> single;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        pair<Node<PlayerData, string> *, bool> result = single.upsert(rows[i].name, row_data(rows[i]));
+        AddRow add(rows[i]);
+        add(result.first, result.second);
+    }
+    double single_ms = elapsed_ms(start);
+
+    // Threads take every thread_count'th row and lock its shard
+    ShardedTree<PlayerData> locked(shard_count);
+    start = Clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++)
+    {
+        threads.push_back(thread([&, t]() {
+            for (size_t i = t; i < rows.size(); i += thread_count)
+            {
+                AddRow add(rows[i]);
+                locked.apply(rows[i].name, row_data(rows[i]), add);
+            }
+        }));
+    }
+    for (int t = 0; t < thread_count; t++)
+        threads[t].join();
+    double locked_ms = elapsed_ms(start);
+
+    // Every thread owns the shards with index % thread_count == t
+    ShardedTree<PlayerData> owned(shard_count);
+    start = Clock::now();
+    threads.clear();
+    for (int t = 0; t < thread_count; t++)
+    {
+        threads.push_back(thread([&, t]() {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                if (owned.shard_of(rows[i].name) % thread_count != (size_t)t)
+                    continue;
+                AddRow add(rows[i]);
+                owned.apply_owned(rows[i].name, row_data(rows[i]), add);
+            }
+        }));
+    }
+    for (int t = 0; t < thread_count; t++)
+        threads[t].join();
+    double owned_ms = elapsed_ms(start);
+
+    Checksum single_sum, locked_sum, owned_sum;
+    single.inorder(single_sum);
+    start = Clock::now();
+    locked.inorder(locked_sum);
+    double merge_ms = elapsed_ms(start);
+    owned.inorder(owned_sum);
+    bool same = single_sum.value == locked_sum.value && single_sum.value == owned_sum.value &&
+                single.size() == locked.size() && single.size() == owned.size();
+
+    cout << "Rows: " << rows.size() << ", players: " << single.size() << ", threads: " << thread_count
+         << ", shards: " << shard_count << endl;
+    cout << "Single tree:    " << single_ms << " ms" << endl;
+    cout << "Locked shards:  " << locked_ms << " ms" << endl;
+    cout << "Owned shards:   " << owned_ms << " ms" << endl;
+    cout << "Sorted merge:   " << merge_ms << " ms" << endl;
+    cout << (same ? "Totals match" : "TOTALS DIFFER") << endl;
+
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
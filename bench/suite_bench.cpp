@@ -0,0 +1,168 @@
+/**
+ * Times the stages of a run on a csv file: parsing, insert (with
+ * fix_insert) of every player, search of every row, upsert of every row and
+ * the season reports. Use gen_csv to make inputs of any size.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/suite_bench.cpp -o suite_bench
+ * Run:     ./suite_bench [--dump=full|off|changed|binary] filename.csv
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdio>  // fopen
+#include <cstring> // strncmp
+#include <string>
+#include <vector>
+
+#include "../include/CsvReader.h"
+#include "../include/League.h"
+#include "../include/OutputBuffer.h"
+#include "../include/PlayerData.h"
+#include "../include/PlayerKeys.h"
+#include "../include/RedBlackTree.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double elapsed_ms(Clock::time_point start, Clock::time_point stop)
+{
+    return chrono::duration_cast<chrono::microseconds>(stop - start).count() / 1000.0;
+}
+
+/**
+ * Prints a line of the result table.
+ */
+static void print_stage(const char *stage, double ms, size_t operations)
+{
+    cout << stage << ms << " ms, " << (operations != 0 ? ms * 1e6 / operations : 0) << " ns per op ("
+         << operations << " ops)" << endl;
+}
+
+static PlayerData row_data(const CsvRow &row)
+{
+    return PlayerData(0, row.point, row.rebound, row.assist);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--dump=", 7) == 0)
+        {
+            if (!parse_dump_mode(argv[i] + 7, options.dump_mode))
+            {
+                cerr << "Unknown dump mode: " << argv[i] + 7 << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else
+            options.filename = argv[i];
+    }
+
+    MappedFile file;
+    if (options.filename == NULL || !file.open(options.filename))
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Parsing
+    Clock::time_point start = Clock::now();
+    vector<CsvRow> rows;
+    CsvReader reader(file.data(), file.size());
+    reader.skip_line();
+    CsvRow row;
+    while (reader.next(row))
+        rows.push_back(row);
+    Clock::time_point stop = Clock::now();
+    double parse_ms = elapsed_ms(start, stop);
+
+    // First row of every player, found with a separate tree
+    vector<const CsvRow *> players;
+    {
+        RedBlackTree<PlayerData, string> seen;
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            if (seen.upsert(rows[i].name, row_data(rows[i])).second)
+                players.push_back(&rows[i]);
+        }
+    }
+
+    // Insert of new nodes, each followed by fix_insert
+    RedBlackTree<PlayerData, string> tree;
+    start = Clock::now();
+    for (size_t i = 0; i < players.size(); i++)
+        tree.insert(tree.create_node(row_data(*players[i]), players[i]->name.str()));
+    stop = Clock::now();
+    double insert_ms = elapsed_ms(start, stop);
+
+    // Search of the player of every row
+    long long checksum = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < rows.size(); i++)
+        checksum += tree.search(rows[i].name)->data.total_point;
+    stop = Clock::now();
+    double search_ms = elapsed_ms(start, stop);
+
+    // Upsert of every row into an empty tree, as the program does
+    RedBlackTree<PlayerData, string> upserted;
+    start = Clock::now();
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        pair<Node<PlayerData, string> *, bool> result = upserted.upsert(rows[i].name, row_data(rows[i]));
+        if (!result.second)
+            result.first->data.update(rows[i].point, rows[i].assist, rows[i].rebound);
+    }
+    stop = Clock::now();
+    double upsert_ms = elapsed_ms(start, stop);
+
+    // Whole run, with the season reports timed separately
+    FILE *null_file = fopen("/dev/null", "w");
+    double add_ms = 0;
+    double report_ms = 0;
+    size_t seasons = 0;
+    {
+        NameKeys keys;
+        League<NameKeys> league(keys, options);
+        OutputBuffer out(null_file);
+        Clock::time_point run_start = Clock::now();
+
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            if (rows[i].season != league.season())
+            {
+                start = Clock::now();
+                league.end_season(out);
+                stop = Clock::now();
+                report_ms += elapsed_ms(start, stop);
+
+                league.start_season(rows[i].season);
+                seasons++;
+            }
+
+            league.add(rows[i]);
+        }
+
+        start = Clock::now();
+        league.finish(out);
+        out.flush();
+        stop = Clock::now();
+        report_ms += elapsed_ms(start, stop);
+
+        // Rows are not timed one by one, the clock would cost more than a row
+        add_ms = elapsed_ms(run_start, stop) - report_ms;
+    }
+    fclose(null_file);
+
+    cout << "Rows: " << rows.size() << ", players: " << players.size() << ", seasons: " << seasons << endl;
+    print_stage("Parse:         ", parse_ms, rows.size());
+    print_stage("Insert:        ", insert_ms, players.size());
+    print_stage("Search:        ", search_ms, rows.size());
+    print_stage("Upsert:        ", upsert_ms, rows.size());
+    print_stage("League add:    ", add_ms, rows.size());
+    print_stage("Season report: ", report_ms, seasons);
+    cout << "(checksum " << checksum << ")" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/**
+ * Counts key comparisons of search + insert against a single upsert.
+ *
+ * Compile: g++ -std=c++11 -Wall -O2 bench/upsert_bench.cpp -o upsert_bench
+ * Run:     ./upsert_bench euroleague.csv
+ */
+#include <iostream>
+#include <fstream> // ifstream
+#include <string>
+#include <vector>
+
+#include "../include/PlayerData.h"
+#include "../include/RedBlackTree.h"
+#include "../include/StringInterner.h"
+
+using namespace std;
+
+/**
+ * String key which counts every comparison made on it.
+ */
+struct CountedKey
+{
+    static long long comparisons;
+    string value;
+
+    CountedKey()
+    {
+    }
+
+    CountedKey(const string &value) : value(value)
+    {
+    }
+
+    bool operator==(const CountedKey &r) const
+    {
+        comparisons++;
+        return value == r.value;
+    }
+
+    bool operator<(const CountedKey &r) const
+    {
+        comparisons++;
+        return value < r.value;
+    }
+};
+
+long long CountedKey::comparisons = 0;
+
+struct Row
+{
+    string name;
+    unsigned int team;
+    int rebound, assist, point;
+};
+
+/**
+ * Reads every row of the csv file.
+ */
+static bool read_rows(const char *filename, vector<Row> &rows)
+{
+    StringInterner teams;
+    ifstream file(filename);
+    if (!file)
+        return false;
+
+    string line;
+    getline(file, line);
+    while (getline(file, line, ','))
+    {
+        Row row;
+        getline(file, row.name, ',');
+        getline(file, line, ',');
+        row.team = teams.intern(line);
+        getline(file, line, ',');
+        row.rebound = stoi(line);
+        getline(file, line, ',');
+        row.assist = stoi(line);
+        getline(file, line, '\n');
+        row.point = stoi(line);
+        rows.push_back(row);
+    }
+    return true;
+}
+
+/**
+ * Ingests rows with search and, on a miss, insert.
+ */
+static long long run_search_insert(const vector<Row> &rows)
+{
+    RedBlackTree<PlayerData, CountedKey> tree;
+    CountedKey::comparisons = 0;
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const Row &row = rows[i];
+        CountedKey key(row.name);
+        Node<PlayerData, CountedKey> *node = tree.search(key);
+        if (node == NULL)
+            tree.insert(tree.create_node(PlayerData(row.team, row.point, row.rebound, row.assist), key));
+        else
+            node->data.update(row.point, row.assist, row.rebound);
+    }
+    return CountedKey::comparisons;
+}
+
+/**
+ * Ingests rows with upsert.
+ */
+static long long run_upsert(const vector<Row> &rows)
+{
+    RedBlackTree<PlayerData, CountedKey> tree;
+    CountedKey::comparisons = 0;
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const Row &row = rows[i];
+        pair<Node<PlayerData, CountedKey> *, bool> result =
+            tree.upsert(CountedKey(row.name), PlayerData(row.team, row.point, row.rebound, row.assist));
+        if (!result.second)
+            result.first->data.update(row.point, row.assist, row.rebound);
+    }
+    return CountedKey::comparisons;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        cerr << "File name is not given as argument" << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<Row> rows;
+    if (!read_rows(argv[1], rows) || rows.empty())
+    {
+        cerr << "File cannot be opened!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    long long before = run_search_insert(rows);
+    long long after = run_upsert(rows);
+    double n = rows.size();
+
+    cout << "Rows: " << rows.size() << endl;
+    cout << "search + insert: " << before << " comparisons, " << before / n << " per row" << endl;
+    cout << "upsert:          " << after << " comparisons, " << after / n << " per row" << endl;
+    cout << "Saved:           " << before - after << " comparisons, " << (before - after) / n << " per row" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,467 @@
+/**
+ * BTree class. Ordered map with wide nodes, an alternative to RedBlackTree.
+ */
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <cstddef>
+#include <string>
+#include <type_traits> // is_scalar
+#include <utility>     // forward, pair
+
+#include "Node.h" // Color
+#include "NodePool.h"
+
+using namespace std;
+
+/**
+ * Keys of a BTree node. Scalar keys, e.g. interned ids, are copied next to
+ * each other in the node, so a search reads them without touching the
+ * records.
+ */
+template <class Key, int MAX_KEYS, bool = is_scalar<Key>::value>
+struct BTreeKeys
+{
+    Key keys[MAX_KEYS];
+
+    void set(int i, const Key &key)
+    {
+        keys[i] = key;
+    }
+
+    /**
+     * Finds position of a key: first key that is not less than the given
+     * key. Binary search.
+     *
+     * @param found {bool} Set if the key at the position is the given key.
+     */
+    template <class Record, class K>
+    int find(Record *const *, int count, const K &key, bool &found) const
+    {
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int middle = (low + high) / 2;
+            if (keys[middle] < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        found = low < count && keys[low] == key;
+        return low;
+    }
+};
+
+/**
+ * Keys of a BTree node which are not scalar. They are read from the
+ * records, so a node holds no second copy.
+ */
+template <class Key, int MAX_KEYS>
+struct BTreeKeys<Key, MAX_KEYS, false>
+{
+    void set(int, const Key &)
+    {
+    }
+
+    template <class Record, class K>
+    int find(Record *const *records, int count, const K &key, bool &found) const
+    {
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int middle = (low + high) / 2;
+            if (records[middle]->key < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        found = low < count && records[low]->key == key;
+        return low;
+    }
+};
+
+/**
+ * First 8 bytes of a string as a number, the first byte highest and missing
+ * bytes zero. If the prefixes of two strings differ, they compare like the
+ * strings.
+ */
+inline unsigned long long key_prefix(const char *data, size_t length)
+{
+    unsigned long long prefix = 0;
+    for (size_t i = 0; i < 8; i++)
+        prefix = (prefix << 8) | (i < length ? (unsigned char)data[i] : 0);
+    return prefix;
+}
+
+inline unsigned long long key_prefix(const string &key)
+{
+    return key_prefix(key.data(), key.length());
+}
+
+/**
+ * Prefix of a view with data and length members, e.g. FieldView.
+ */
+template <class View>
+unsigned long long key_prefix(const View &key)
+{
+    return key_prefix(key.data, key.length);
+}
+
+/**
+ * Keys of a BTree node which are strings. The strings are read from the
+ * records, and a prefix of each is copied into the node. A search compares
+ * the prefixes and reads a record only when its prefix is equal.
+ */
+template <int MAX_KEYS>
+struct BTreeKeys<string, MAX_KEYS, false>
+{
+    unsigned long long prefixes[MAX_KEYS];
+
+    void set(int i, const string &key)
+    {
+        prefixes[i] = key_prefix(key);
+    }
+
+    template <class Record, class K>
+    int find(Record *const *records, int count, const K &key, bool &found) const
+    {
+        unsigned long long prefix = key_prefix(key);
+        int low = 0;
+        int high = count;
+        while (low < high)
+        {
+            int middle = (low + high) / 2;
+            if (prefixes[middle] < prefix || (prefixes[middle] == prefix && records[middle]->key < key))
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        found = low < count && prefixes[low] == prefix && records[low]->key == key;
+        return low;
+    }
+};
+
+/**
+ * B-tree keyed by Key. A node holds up to MAX_KEYS sorted entries next to
+ * each other, so a search reads a few cache lines per level instead of one
+ * node per key comparison. Data lives in separately allocated records with
+ * stable addresses; nodes hold pointers to them, and copies of scalar keys
+ * or prefixes of string keys.
+ *
+ * Has the search/upsert/preorder contract of RedBlackTree. Records are
+ * never removed.
+ */
+template <class Data, class Key, int MAX_KEYS = 15>
+class BTree
+{
+public:
+    /**
+     * Key and data of an entry.
+     */
+    struct Record
+    {
+        Key key;
+        Data data;
+
+        template <class K, class D>
+        Record(K &&key, D &&data) : key(std::forward<K>(key)), data(std::forward<D>(data))
+        {
+        }
+    };
+
+    // Type of the entries returned by search and upsert
+    typedef Record entry_type;
+
+    /**
+     * Entry passed to preorder visitors. Has the fields a visitor of
+     * RedBlackTree uses. Entries have no color, it is always BLACK.
+     */
+    struct NodeView
+    {
+        const Key &key;
+        Color color;
+        const Data &data;
+
+        NodeView(const Key &key, const Data &data) : key(key), color(BLACK), data(data)
+        {
+        }
+    };
+
+private:
+    // Deep enough for any tree that fits in memory
+    static const int MAX_DEPTH = 64;
+
+    struct BTreeNode
+    {
+        int count; // Number of keys
+        BTreeKeys<Key, MAX_KEYS> keys;
+        Record *records[MAX_KEYS];
+        BTreeNode *children[MAX_KEYS + 1]; // All NULL in a leaf
+
+        BTreeNode() : count(0)
+        {
+            for (int i = 0; i <= MAX_KEYS; i++)
+                children[i] = NULL;
+        }
+
+        /**
+         * Puts a record at a position, with its key.
+         */
+        void set(int i, Record *record)
+        {
+            records[i] = record;
+            keys.set(i, record->key);
+        }
+    };
+
+    BTreeNode *root;
+    size_t record_count;
+    NodePool<BTreeNode> node_pool;
+    NodePool<Record> record_pool;
+
+    BTree(const BTree &);
+    BTree &operator=(const BTree &);
+
+    /**
+     * Finds position of a key in a node: first key that is not less than
+     * the given key.
+     *
+     * @param found {bool} Set if the key at the position is the given key.
+     */
+    template <class K>
+    static int find_position(const BTreeNode *node, const K &key, bool &found)
+    {
+        return node->keys.find(node->records, node->count, key, found);
+    }
+
+    /**
+     * Inserts a record and right child at a position of a node which has
+     * free space.
+     */
+    static void insert_at(BTreeNode *node, int pos, Record *record, BTreeNode *right)
+    {
+        for (int i = node->count; i > pos; i--)
+        {
+            node->set(i, node->records[i - 1]);
+            node->children[i + 1] = node->children[i];
+        }
+        node->set(pos, record);
+        node->children[pos + 1] = right;
+        node->count++;
+    }
+
+    template <class Visitor>
+    static void preorder(const BTreeNode *node, int depth, Visitor &visit)
+    {
+        if (node == NULL)
+            return;
+
+        for (int i = 0; i < node->count; i++)
+        {
+            // Key of the record, keys copied into nodes move when nodes are split
+            NodeView view(node->records[i]->key, node->records[i]->data);
+            visit(&view, depth);
+        }
+        for (int i = 0; i <= node->count; i++)
+            preorder(node->children[i], depth + 1, visit);
+    }
+
+    template <class Visitor>
+    static void inorder(BTreeNode *node, Visitor &visit)
+    {
+        if (node == NULL)
+            return;
+
+        for (int i = 0; i < node->count; i++)
+        {
+            inorder(node->children[i], visit);
+            visit(node->records[i]);
+        }
+        inorder(node->children[node->count], visit);
+    }
+
+public:
+    BTree() : root(NULL), record_count(0)
+    {
+    }
+
+    /**
+     * Search for a record in the tree.
+     *
+     * @param key {K} Key to be used in comparison. Any type comparable with Key.
+     *
+     * @return {Record*} NULL or record with the given key.
+     */
+    template <class K>
+    Record *search(const K &key) const
+    {
+        const BTreeNode *node = root;
+        bool found;
+        while (node != NULL)
+        {
+            int pos = find_position(node, key, found);
+            if (found)
+                return node->records[pos];
+            node = node->children[pos];
+        }
+        return NULL;
+    }
+
+    /**
+     * Finds the record with the given key, inserts a new one if it does not
+     * exist. Uses a single descent from the root; full nodes on the way back
+     * up are split.
+     *
+     * @param key {K} Key to be searched. Any type comparable with Key and
+     * convertible to it. The key of a new record is built from it in place.
+     * @param data {D} Data of the new record, moved if it is a temporary.
+     * Not used if key exists.
+     *
+     * @return {pair<Record*, bool>} Record with the given key and whether it
+     * is inserted by this call.
+     */
+    template <class K, class D>
+    pair<Record *, bool> upsert(const K &key, D &&data)
+    {
+        BTreeNode *path[MAX_DEPTH];
+        int positions[MAX_DEPTH];
+        int depth = 0;
+
+        BTreeNode *node = root;
+        bool found;
+        while (node != NULL)
+        {
+            int pos = find_position(node, key, found);
+            if (found)
+                return make_pair(node->records[pos], false);
+
+            path[depth] = node;
+            positions[depth] = pos;
+            depth++;
+            node = node->children[pos];
+        }
+
+        Record *record = record_pool.create(key, std::forward<D>(data));
+        record_count++;
+
+        // Insert into the leaf, split full nodes on the way up. Only record
+        // pointers move, keys stay in the records.
+        Record *up_record = record;
+        BTreeNode *up_right = NULL;
+
+        while (depth > 0)
+        {
+            depth--;
+            node = path[depth];
+            int pos = positions[depth];
+
+            if (node->count < MAX_KEYS)
+            {
+                insert_at(node, pos, up_record, up_right);
+                return make_pair(record, true);
+            }
+
+            // Full node: gather MAX_KEYS + 1 records, keep the left half,
+            // move the right half to a new node and push the middle one up
+            Record *records[MAX_KEYS + 1];
+            BTreeNode *children[MAX_KEYS + 2];
+
+            children[0] = node->children[0];
+            for (int i = 0, j = 0; i <= MAX_KEYS; i++)
+            {
+                if (i == pos)
+                {
+                    records[i] = up_record;
+                    children[i + 1] = up_right;
+                }
+                else
+                {
+                    records[i] = node->records[j];
+                    children[i + 1] = node->children[j + 1];
+                    j++;
+                }
+            }
+
+            int middle = (MAX_KEYS + 1) / 2;
+            BTreeNode *right = node_pool.create();
+
+            node->count = middle;
+            for (int i = 0; i < middle; i++)
+            {
+                node->set(i, records[i]);
+                node->children[i] = children[i];
+            }
+            node->children[middle] = children[middle];
+            for (int i = middle + 1; i <= MAX_KEYS; i++)
+                node->children[i] = NULL;
+
+            right->count = MAX_KEYS - middle;
+            for (int i = middle + 1, j = 0; i <= MAX_KEYS; i++, j++)
+            {
+                right->set(j, records[i]);
+                right->children[j] = children[i];
+            }
+            right->children[right->count] = children[MAX_KEYS + 1];
+
+            up_record = records[middle];
+            up_right = right;
+        }
+
+        // Root was split or tree was empty, grow a new root
+        BTreeNode *new_root = node_pool.create();
+        new_root->set(0, up_record);
+        new_root->children[0] = root;
+        new_root->children[1] = up_right;
+        new_root->count = 1;
+        root = new_root;
+
+        return make_pair(record, true);
+    }
+
+    /**
+     * Returns number of records in the tree.
+     */
+    size_t size() const
+    {
+        return record_count;
+    }
+
+    /**
+     * Visits all keys, node by node in preorder. Keys of a node are visited
+     * together, at the depth of the node.
+     *
+     * @param visit {Visitor} Called as visit(NodeView*, depth).
+     */
+    template <class Visitor>
+    void preorder(Visitor &visit) const
+    {
+        preorder(root, 0, visit);
+    }
+
+    /**
+     * Visits all records in sorted order.
+     *
+     * @param visit {Visitor} Called as visit(Record*).
+     */
+    template <class Visitor>
+    void inorder(Visitor &visit)
+    {
+        inorder(root, visit);
+    }
+
+    /**
+     * Removes all records.
+     */
+    void clear()
+    {
+        node_pool.release_all();
+        record_pool.release_all();
+        root = NULL;
+        record_count = 0;
+    }
+};
+
+#endif
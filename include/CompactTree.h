@@ -0,0 +1,475 @@
+/**
+ * CompactRedBlackTree class. Red-black tree with a compact, split node layout.
+ */
+
+#ifndef COMPACTTREE_H
+#define COMPACTTREE_H
+
+#include <cstddef>
+#include <type_traits> // is_scalar
+#include <utility>     // forward, move, pair
+#include <vector>
+
+#include "Node.h" // Color
+
+using namespace std;
+
+/**
+ * Vector of fixed size chunks. Elements never move, so pointers to them stay
+ * valid while the vector grows.
+ */
+template <class T>
+class ChunkedVector
+{
+private:
+    static const unsigned int CHUNK_BITS = 12;
+    static const unsigned int CHUNK_SIZE = 1u << CHUNK_BITS;
+
+    vector<vector<T> > chunks;
+    size_t count;
+
+public:
+    ChunkedVector() : count(0)
+    {
+    }
+
+private:
+    /**
+     * Starts a new chunk if the last one is full.
+     */
+    void next_chunk()
+    {
+        if ((count & (CHUNK_SIZE - 1)) == 0)
+        {
+            chunks.push_back(vector<T>());
+            chunks.back().reserve(CHUNK_SIZE);
+        }
+    }
+
+public:
+
+    T &operator[](size_t index)
+    {
+        return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+
+    const T &operator[](size_t index) const
+    {
+        return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+
+    void push_back(const T &value)
+    {
+        next_chunk();
+        chunks.back().push_back(value);
+        count++;
+    }
+
+    void push_back(T &&value)
+    {
+        next_chunk();
+        chunks.back().push_back(std::move(value));
+        count++;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+};
+
+/**
+ * Key of a hot node. Scalar keys, e.g. interned ids, are copied into the
+ * hot node, so a search reads them without touching the records.
+ */
+template <class Key, bool = is_scalar<Key>::value>
+struct CompactKey
+{
+    Key key;
+
+    const Key &get() const
+    {
+        return key;
+    }
+
+    void set(const Key &record_key)
+    {
+        key = record_key;
+    }
+};
+
+/**
+ * Key of a hot node which is not scalar, e.g. a string. It points to the key
+ * of the record, so a node holds no second copy.
+ */
+template <class Key>
+struct CompactKey<Key, false>
+{
+    const Key *key;
+
+    const Key &get() const
+    {
+        return *key;
+    }
+
+    void set(const Key &record_key)
+    {
+        key = &record_key;
+    }
+};
+
+/**
+ * Red-black tree whose nodes are split in two parts.
+ *
+ * Hot part holds the key, two 32 bit child indices and the parent index with
+ * the color in its top bit. Hot parts are kept in a single vector (16 bytes
+ * for an int key), so a step of a search is one load, and they refer to each
+ * other by index, which survives reallocation. Cold part holds the key and
+ * the data in chunks with stable addresses. It is touched only when a node
+ * is found. Intended for small keys such as interned ids; other keys are
+ * built once into the cold part and read through a pointer.
+ *
+ * Nodes are never removed. Records (key, data) have stable addresses.
+ */
+template <class Data, class Key>
+class CompactRedBlackTree
+{
+public:
+    /**
+     * Cold part of a node. Records never move, so hot parts may point to
+     * the key.
+     */
+    struct Record
+    {
+        Key key; // Not changed after insert
+        Data data;
+
+        template <class D>
+        Record(Key &&key, D &&data) : key(std::move(key)), data(std::forward<D>(data))
+        {
+        }
+    };
+
+    // Type of the entries returned by search and upsert
+    typedef Record entry_type;
+
+    /**
+     * Node passed to preorder visitors. Has the fields a visitor of
+     * RedBlackTree uses.
+     */
+    struct NodeView
+    {
+        const Key &key;
+        Color color;
+        const Data &data;
+
+        NodeView(const Key &key, Color color, const Data &data) : key(key), color(color), data(data)
+        {
+        }
+    };
+
+private:
+    static const unsigned int NIL = 0x7FFFFFFFu;
+    static const unsigned int RED_BIT = 0x80000000u;
+
+    struct HotNode
+    {
+        CompactKey<Key> key;
+        unsigned int left;
+        unsigned int right;
+        unsigned int parent_color; // Parent index, top bit set if red
+    };
+
+    vector<HotNode> hot;
+    ChunkedVector<Record> cold;
+    unsigned int root;
+
+    unsigned int parent(unsigned int i) const
+    {
+        return hot[i].parent_color & ~RED_BIT;
+    }
+
+    void set_parent(unsigned int i, unsigned int p)
+    {
+        hot[i].parent_color = (hot[i].parent_color & RED_BIT) | p;
+    }
+
+    bool is_red(unsigned int i) const
+    {
+        return i != NIL && (hot[i].parent_color & RED_BIT) != 0;
+    }
+
+    void set_color(unsigned int i, Color color)
+    {
+        if (color == RED)
+            hot[i].parent_color |= RED_BIT;
+        else
+            hot[i].parent_color &= ~RED_BIT;
+    }
+
+    /**
+     * Replaces child old_child of p with new_child. p may be NIL.
+     */
+    void replace_child(unsigned int p, unsigned int old_child, unsigned int new_child)
+    {
+        if (p == NIL)
+            root = new_child;
+        else if (hot[p].left == old_child)
+            hot[p].left = new_child;
+        else
+            hot[p].right = new_child;
+    }
+
+    /**
+     * Left rotate on a subtree.
+     *
+     * @param i {unsigned int} Root of the subtree. Will be left child of the root after rotation.
+     */
+    void rotate_left(unsigned int i)
+    {
+        unsigned int r = hot[i].right;
+        unsigned int p = parent(i);
+
+        hot[i].right = hot[r].left;
+        if (hot[r].left != NIL)
+            set_parent(hot[r].left, i);
+
+        replace_child(p, i, r);
+        set_parent(r, p);
+        hot[r].left = i;
+        set_parent(i, r);
+    }
+
+    /**
+     * Right rotate on a subtree.
+     *
+     * @param i {unsigned int} Root of the subtree. Will be right child of the root after rotation.
+     */
+    void rotate_right(unsigned int i)
+    {
+        unsigned int l = hot[i].left;
+        unsigned int p = parent(i);
+
+        hot[i].left = hot[l].right;
+        if (hot[l].right != NIL)
+            set_parent(hot[l].right, i);
+
+        replace_child(p, i, l);
+        set_parent(l, p);
+        hot[l].right = i;
+        set_parent(i, l);
+    }
+
+    /**
+     * Maintains red-black property after insertion of a new red node.
+     */
+    void fix_insert(unsigned int i)
+    {
+        while (is_red(parent(i)))
+        {
+            unsigned int p = parent(i);
+            unsigned int g = parent(p);
+
+            if (hot[g].left == p)
+            {
+                unsigned int uncle = hot[g].right;
+                if (is_red(uncle))
+                {
+                    // Recolor and continue from grandparent
+                    set_color(p, BLACK);
+                    set_color(uncle, BLACK);
+                    set_color(g, RED);
+                    i = g;
+                    continue;
+                }
+                if (hot[p].right == i)
+                {
+                    // LeftRight, turn into LeftLeft
+                    rotate_left(p);
+                    i = p;
+                    p = parent(i);
+                }
+                // LeftLeft
+                set_color(p, BLACK);
+                set_color(g, RED);
+                rotate_right(g);
+            }
+            else
+            {
+                unsigned int uncle = hot[g].left;
+                if (is_red(uncle))
+                {
+                    // Recolor and continue from grandparent
+                    set_color(p, BLACK);
+                    set_color(uncle, BLACK);
+                    set_color(g, RED);
+                    i = g;
+                    continue;
+                }
+                if (hot[p].left == i)
+                {
+                    // RightLeft, turn into RightRight
+                    rotate_right(p);
+                    i = p;
+                    p = parent(i);
+                }
+                // RightRight
+                set_color(p, BLACK);
+                set_color(g, RED);
+                rotate_left(g);
+            }
+        }
+
+        // Root is always BLACK
+        set_color(root, BLACK);
+    }
+
+    template <class Visitor>
+    void preorder(unsigned int i, int depth, Visitor &visit) const
+    {
+        if (i == NIL)
+            return;
+
+        NodeView view(cold[i].key, is_red(i) ? RED : BLACK, cold[i].data);
+        visit(&view, depth);
+        preorder(hot[i].left, depth + 1, visit);
+        preorder(hot[i].right, depth + 1, visit);
+    }
+
+    template <class Visitor>
+    void inorder(unsigned int i, Visitor &visit)
+    {
+        if (i == NIL)
+            return;
+
+        inorder(hot[i].left, visit);
+        visit(&cold[i]);
+        inorder(hot[i].right, visit);
+    }
+
+public:
+    CompactRedBlackTree() : root(NIL)
+    {
+    }
+
+    /**
+     * Search for a record in the tree.
+     *
+     * @param key {K} Key to be used in comparison. Any type comparable with Key.
+     *
+     * @return {Record*} NULL or record with the given key.
+     */
+    template <class K>
+    Record *search(const K &key)
+    {
+        unsigned int i = root;
+        while (i != NIL)
+        {
+            const HotNode &node = hot[i];
+            if (node.key.get() == key)
+                return &cold[i];
+            i = (node.key.get() < key) ? node.right : node.left;
+        }
+        return NULL;
+    }
+
+    /**
+     * Finds the record with the given key, inserts a new one if it does not
+     * exist. Uses a single descent from the root.
+     *
+     * @param key {K} Key to be searched. Any type comparable with Key and
+     * convertible to it.
+     * @param data {D} Data of the new record, moved if it is a temporary.
+     * Not used if key exists.
+     *
+     * @return {pair<Record*, bool>} Record with the given key and whether it
+     * is inserted by this call.
+     */
+    template <class K, class D>
+    pair<Record *, bool> upsert(const K &key, D &&data)
+    {
+        unsigned int p = NIL;
+        unsigned int i = root;
+        bool go_right = false;
+
+        while (i != NIL)
+        {
+            const HotNode &node = hot[i];
+            if (node.key.get() == key)
+                return make_pair(&cold[i], false);
+            p = i;
+            go_right = node.key.get() < key;
+            i = go_right ? node.right : node.left;
+        }
+
+        // Key does not exist, link a new red node to the last visited node.
+        // The key is built once into the record.
+        i = (unsigned int)hot.size();
+        cold.push_back(Record(Key(key), std::forward<D>(data)));
+
+        HotNode node;
+        node.key.set(cold[i].key);
+        node.left = NIL;
+        node.right = NIL;
+        node.parent_color = p | RED_BIT;
+        hot.push_back(node);
+
+        if (p == NIL)
+            root = i;
+        else if (go_right)
+            hot[p].right = i;
+        else
+            hot[p].left = i;
+
+        fix_insert(i);
+        return make_pair(&cold[i], true);
+    }
+
+    /**
+     * Returns number of nodes in the tree.
+     */
+    size_t size() const
+    {
+        return hot.size();
+    }
+
+    /**
+     * Visits all nodes in preorder.
+     *
+     * @param visit {Visitor} Called as visit(NodeView*, depth).
+     */
+    template <class Visitor>
+    void preorder(Visitor &visit) const
+    {
+        preorder(root, 0, visit);
+    }
+
+    /**
+     * Visits all records in sorted order.
+     *
+     * @param visit {Visitor} Called as visit(Record*).
+     */
+    template <class Visitor>
+    void inorder(Visitor &visit)
+    {
+        inorder(root, visit);
+    }
+
+    /**
+     * Removes all nodes.
+     */
+    void clear()
+    {
+        hot.clear();
+        cold.clear();
+        root = NIL;
+    }
+};
+
+#endif
@@ -0,0 +1,345 @@
+/**
+ * Memory mapped csv reader for Season,Name,Team,Rebound,Assist,Point files.
+ */
+
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <cstring> // memchr, memcmp
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator> // istreambuf_iterator
+#include <vector>
+#else
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+#endif
+
+using namespace std;
+
+/**
+ * Non-owning view of a field in the input buffer.
+ */
+struct FieldView
+{
+    const char *data;
+    size_t length;
+
+    FieldView() : data(NULL), length(0)
+    {
+    }
+
+    FieldView(const char *data, size_t length) : data(data), length(length)
+    {
+    }
+
+    /**
+     * Copies the field into a string.
+     */
+    string str() const
+    {
+        return string(data, length);
+    }
+
+    operator string() const
+    {
+        return str();
+    }
+
+    /**
+     * Three way comparison with a character sequence.
+     */
+    int compare(const char *r, size_t r_length) const
+    {
+        int result = memcmp(data, r, length < r_length ? length : r_length);
+        if (result != 0)
+            return result;
+        return length < r_length ? -1 : (length > r_length ? 1 : 0);
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const FieldView &val)
+    {
+        os.write(val.data, val.length);
+        return os;
+    }
+
+    friend bool operator==(const FieldView &l, const FieldView &r)
+    {
+        return l.length == r.length && memcmp(l.data, r.data, l.length) == 0;
+    }
+
+    friend bool operator!=(const FieldView &l, const FieldView &r)
+    {
+        return !(l == r);
+    }
+
+    friend bool operator==(const string &l, const FieldView &r)
+    {
+        return l.length() == r.length && memcmp(l.data(), r.data, r.length) == 0;
+    }
+
+    friend bool operator<(const string &l, const FieldView &r)
+    {
+        return r.compare(l.data(), l.length()) > 0;
+    }
+};
+
+/**
+ * One row of the csv file. Text fields point into the input buffer.
+ */
+struct CsvRow
+{
+    FieldView season;
+    FieldView name;
+    FieldView team;
+    int rebound;
+    int assist;
+    int point;
+};
+
+/**
+ * Read-only view of a whole file. Uses mmap where available, reads the file
+ * into memory otherwise.
+ */
+class MappedFile
+{
+private:
+    const char *begin;
+    size_t length;
+#ifdef _WIN32
+    vector<char> buffer;
+#endif
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+public:
+    MappedFile() : begin(NULL), length(0)
+    {
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /**
+     * Maps a file into memory.
+     *
+     * @param filename {const char*} Path of the file.
+     *
+     * @return {bool} False if the file cannot be opened.
+     */
+    bool open(const char *filename)
+    {
+        close();
+#ifdef _WIN32
+        ifstream file(filename, ios::binary);
+        if (!file)
+            return false;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        begin = buffer.empty() ? NULL : &buffer[0];
+        length = buffer.size();
+        return true;
+#else
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        length = st.st_size;
+        if (length != 0)
+        {
+            void *ptr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(ptr, length, MADV_SEQUENTIAL);
+            begin = static_cast<const char *>(ptr);
+        }
+
+        // Mapping stays valid after the descriptor is closed
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    /**
+     * Unmaps the file.
+     */
+    void close()
+    {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (begin != NULL)
+            munmap(const_cast<char *>(begin), length);
+#endif
+        begin = NULL;
+        length = 0;
+    }
+
+    const char *data() const
+    {
+        return begin;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+};
+
+/**
+ * Tokenizes csv rows in place.
+ */
+class CsvReader
+{
+private:
+    const char *pos;
+    const char *end;
+
+    /**
+     * Returns the text up to the next delimiter and moves past it.
+     */
+    FieldView next_field(char delimiter)
+    {
+        const char *start = pos;
+        if (pos == end)
+            return FieldView(start, 0);
+
+        const char *stop = static_cast<const char *>(memchr(pos, delimiter, end - pos));
+        if (stop == NULL)
+            stop = end;
+
+        pos = (stop == end) ? end : stop + 1;
+        return FieldView(start, stop - start);
+    }
+
+    /**
+     * Parses a decimal integer. Trailing characters such as '\r' are ignored.
+     */
+    static int parse_int(FieldView field)
+    {
+        const char *ptr = field.data;
+        const char *stop = field.data + field.length;
+        bool negative = false;
+
+        if (ptr != stop && *ptr == '-')
+        {
+            negative = true;
+            ptr++;
+        }
+
+        int value = 0;
+        while (ptr != stop && *ptr >= '0' && *ptr <= '9')
+        {
+            value = value * 10 + (*ptr - '0');
+            ptr++;
+        }
+        return negative ? -value : value;
+    }
+
+public:
+    /**
+     * @param data {const char*} Start of the csv text.
+     * @param length {size_t} Length of the csv text.
+     */
+    CsvReader(const char *data, size_t length) : pos(data), end(data + length)
+    {
+    }
+
+    /**
+     * Skips the rest of the current line. Used for the header.
+     */
+    void skip_line()
+    {
+        next_field('\n');
+    }
+
+    /**
+     * Reads the next row.
+     *
+     * @param row {CsvRow} Filled with the fields of the row.
+     *
+     * @return {bool} False at the end of the input.
+     */
+    bool next(CsvRow &row)
+    {
+        // Skip empty lines
+        while (pos != end && (*pos == '\n' || *pos == '\r'))
+            pos++;
+
+        if (pos == end)
+            return false;
+
+        row.season = next_field(',');
+        row.name = next_field(',');
+        row.team = next_field(',');
+        row.rebound = parse_int(next_field(','));
+        row.assist = parse_int(next_field(','));
+        row.point = parse_int(next_field('\n'));
+        return true;
+    }
+
+    /**
+     * Returns current position in the input.
+     */
+    const char *position() const
+    {
+        return pos;
+    }
+};
+
+/**
+ * Skips the rows of a season already read, if the file contains it.
+ * Otherwise all rows are kept, e.g. for a file with only new seasons.
+ *
+ * @param reader {CsvReader} Reader at the first row.
+ * @param season {FieldView} Last season already read.
+ * @param rows {unsigned int} Number of its rows already read, zero to skip
+ * up to the end of the season.
+ * @param end {const char*} End of the csv text.
+ *
+ * @return {CsvReader} Reader at the first row not read yet.
+ */
+inline CsvReader resume_reader(const CsvReader &reader, const FieldView &season, unsigned int rows,
+                               const char *end)
+{
+    CsvReader scan = reader;
+    const char *resume = NULL;
+    unsigned int skipped = 0;
+
+    CsvRow row;
+    while (scan.next(row))
+    {
+        if (row.season == season)
+        {
+            resume = scan.position();
+            if (++skipped == rows)
+                break;
+        }
+        else if (resume != NULL)
+            break;
+    }
+
+    if (resume == NULL)
+        return reader;
+    return CsvReader(resume, end - resume);
+}
+
+#endif
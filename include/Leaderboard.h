@@ -0,0 +1,110 @@
+/**
+ * Leaderboard class.
+ */
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Ordered index of tree nodes by a score, highest first. Nodes with equal
+ * scores are ordered by key. Every operation is O(log n).
+ *
+ * Nodes are referenced by pointer, so they must not move while they are in
+ * the leaderboard. The score of a node is stored in the index and must be
+ * passed back when it changes.
+ */
+template <class Entry>
+class Leaderboard
+{
+private:
+    struct Item
+    {
+        int score;
+        const Entry *entry;
+
+        Item(int score, const Entry *entry) : score(score), entry(entry)
+        {
+        }
+    };
+
+    struct Compare
+    {
+        bool operator()(const Item &l, const Item &r) const
+        {
+            if (l.score != r.score)
+                return l.score > r.score;
+            return l.entry->key < r.entry->key;
+        }
+    };
+
+    set<Item, Compare> items;
+
+public:
+    /**
+     * Adds a node.
+     *
+     * @param entry {Entry*} Node to be added.
+     * @param score {int} Score of the node.
+     */
+    void insert(const Entry *entry, int score)
+    {
+        items.insert(Item(score, entry));
+    }
+
+    /**
+     * Removes a node.
+     *
+     * @param entry {Entry*} Node to be removed.
+     * @param score {int} Score the node was last inserted or updated with.
+     */
+    void erase(const Entry *entry, int score)
+    {
+        items.erase(Item(score, entry));
+    }
+
+    /**
+     * Changes score of a node.
+     *
+     * @param entry {Entry*} Node in the leaderboard.
+     * @param old_score {int} Score the node was last inserted or updated with.
+     * @param new_score {int} New score of the node.
+     */
+    void update(const Entry *entry, int old_score, int new_score)
+    {
+        if (old_score == new_score)
+            return;
+
+        items.erase(Item(old_score, entry));
+        items.insert(Item(new_score, entry));
+    }
+
+    /**
+     * Returns the first k nodes with their scores.
+     *
+     * @param k {size_t} Number of nodes.
+     * @param result {vector<pair<const Entry*, int>>} Filled with at most k
+     * nodes, highest score first.
+     */
+    void top(size_t k, vector<pair<const Entry *, int> > &result) const
+    {
+        result.clear();
+        typename set<Item, Compare>::const_iterator it = items.begin();
+        for (; it != items.end() && result.size() < k; ++it)
+            result.push_back(make_pair(it->entry, it->score));
+    }
+
+    /**
+     * Returns number of nodes in the leaderboard.
+     */
+    size_t size() const
+    {
+        return items.size();
+    }
+};
+
+#endif
@@ -0,0 +1,1356 @@
+/**
+ * League class. Keeps the player tree and the season reports of a csv file.
+ */
+
+#ifndef LEAGUE_H
+#define LEAGUE_H
+
+#include <chrono>
+#include <cstdio>    // FILE, fprintf
+#include <cstring>   // strchr, strcmp, strlen
+#include <iostream>
+#include <utility>   // move
+#include <vector>
+
+#include "BTree.h"
+#include "CompactTree.h"
+#include "CsvReader.h"
+#include "Leaderboard.h"
+#include "OutputBuffer.h"
+#include "PersistentTree.h"
+#include "PlayerData.h"
+#include "ReadView.h"
+#include "ReportWriter.h"
+#include "RedBlackTree.h"
+#include "Snapshot.h"
+#include "StringInterner.h"
+#include "TeamData.h"
+#include "TreeDump.h"
+
+using namespace std;
+
+/**
+ * Tree used to store the players.
+ */
+enum TreeBackend
+{
+    BACKEND_RB,      // RedBlackTree, supports all options
+    BACKEND_COMPACT, // CompactRedBlackTree, no removal
+    BACKEND_BTREE,   // BTree, no removal
+    BACKEND_PERSISTENT, // PersistentTree, no removal, keeps a version of every season
+};
+
+/**
+ * Parses name of a tree backend.
+ *
+ * @param name {const char*} One of rb, compact, btree, persistent.
+ * @param backend {TreeBackend} Set to the parsed backend.
+ *
+ * @return {bool} False if the name is unknown.
+ */
+inline bool parse_backend(const char *name, TreeBackend &backend)
+{
+    static const char *names[] = {"rb", "compact", "btree", "persistent"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            backend = (TreeBackend)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Command line options.
+ */
+struct Options
+{
+    const char *filename;
+    bool intern_names;
+    DumpMode dump_mode;
+    size_t top;         // Size of the leaderboards, zero if they are not kept
+    const char *prefix; // Players starting with it are listed at the end
+    int retire;         // Players are removed after this many seasons without a row, zero to keep all
+    int jobs;           // Number of parser threads, one for a sequential read
+    const char *save;   // Snapshot written at the end of every season
+    const char *load;   // Snapshot to resume from
+    TreeBackend backend;
+    bool publish_views; // Read-only views published at the end of every season, needs persistent and names
+    unsigned int publish_rows; // Views are also published after this many rows of a season, zero to never
+    const char *stats;  // JSON lines with timings and tree counters of every season
+    unsigned int verify; // Tree is checked after every this many inserts, zero to never check
+    bool teams;          // Team totals are kept and printed at the end of every season
+    bool history;        // Scores of every season are kept for every player
+    bool pipeline;       // Rows are parsed, applied and reported on three threads
+    const char *career;  // Player whose seasons are listed at the end, needs history
+    const char *as_of;   // "SEASON,NAME", totals of a player at the end of a season, needs persistent
+    size_t keep_versions; // Versions of the latest seasons kept for as_of, zero to keep all
+    const char *leaders; // "FROM,TO", players with the highest totals among these names are printed at the end
+
+    Options()
+        : filename(NULL), intern_names(false), dump_mode(DUMP_FULL), top(0), prefix(NULL),
+          retire(0), jobs(1), save(NULL), load(NULL), backend(BACKEND_RB), publish_views(false),
+          publish_rows(0), stats(NULL), verify(0), teams(false),
+          history(false), pipeline(false), career(NULL), as_of(NULL), keep_versions(0), leaders(NULL)
+    {
+    }
+};
+
+/**
+ * Checks that the read-only views can be published with the backend and
+ * keys of the options. Only a PersistentTree keyed by names has frozen
+ * versions that readers can search, other backends would publish nothing.
+ *
+ * @param options {Options} Options of a league.
+ *
+ * @return {bool} False and prints the problem if the views cannot be
+ * published.
+ */
+inline bool check_view_options(const Options &options)
+{
+    if (options.publish_rows != 0 && !options.publish_views)
+    {
+        cerr << "publish_rows needs publish_views" << endl;
+        return false;
+    }
+    if (options.publish_views && (options.backend != BACKEND_PERSISTENT || options.intern_names))
+    {
+        cerr << "publish_views needs --backend=persistent and cannot be used with --intern" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Header of snapshot files, "RBTS" in little endian
+static const unsigned int SNAPSHOT_MAGIC = 0x53544252u;
+static const unsigned int SNAPSHOT_VERSION = 4;
+
+/**
+ * Highest total score seen so far and its player.
+ */
+template <class Key>
+struct MaxScore
+{
+    int value;
+    Key key;
+    bool found;
+
+    MaxScore() : value(0), key(), found(false)
+    {
+    }
+
+    /**
+     * Replaces the maximum if the score is higher.
+     */
+    void update(int score, const Key &player)
+    {
+        if (score > value)
+        {
+            value = score;
+            key = player;
+            found = true;
+        }
+    }
+};
+
+/**
+ * Prints players whose names start with a prefix, in sorted order.
+ * O(log n + k) for k printed players.
+ *
+ * @param out {OutputBuffer} Destination of the report.
+ * @param tree {RedBlackTree} Players keyed by name.
+ * @param prefix {const char*} Start of the names.
+ */
+inline void print_prefix(OutputBuffer &out, const RedBlackTree<PlayerData, string> &tree, const char *prefix)
+{
+    FieldView view(prefix, strlen(prefix));
+    out << "Players starting with " << prefix << ":\n";
+
+    RedBlackTree<PlayerData, string>::iterator it = tree.lower_bound(view);
+    for (; it != tree.end() && it->key.compare(0, view.length, prefix) == 0; ++it)
+        out << it->key << '\n';
+}
+
+/**
+ * Interned trees are not ordered by name. Rejected by main.
+ */
+template <class Tree>
+void print_prefix(OutputBuffer &, const Tree &, const char *)
+{
+}
+
+/**
+ * Prints players with the highest total scores among the names in a range.
+ * Uses the subtree maxima of the tree, O(log n) per score.
+ *
+ * @param out {OutputBuffer} Destination of the report.
+ * @param tree {RedBlackTree} Players keyed by name.
+ * @param range {const char*} First and last name, separated by a comma.
+ */
+inline void print_leaders(OutputBuffer &out, const RedBlackTree<PlayerData, string> &tree, const char *range)
+{
+    const char *comma = strchr(range, ',');
+    FieldView low(range, comma != NULL ? comma - range : strlen(range));
+    FieldView high = comma != NULL ? FieldView(comma + 1, strlen(comma + 1)) : low;
+
+    out << "Leaders from ";
+    out.write(low.data, low.length);
+    out << " to ";
+    out.write(high.data, high.length);
+    out << ":\n";
+
+    static const char *titles[] = {"Points", "Assists", "Rebs"};
+    for (int stat = 0; stat < SubtreeMax<PlayerData>::STAT_COUNT; stat++)
+    {
+        Node<PlayerData, string> *node = tree.range_max(low, high, stat);
+        if (node == NULL)
+        {
+            out << "No players in range\n";
+            return;
+        }
+        out << titles[stat] << ": " << SubtreeMax<PlayerData>::value(node->data, stat)
+            << " - Player Name: " << node->key << '\n';
+    }
+}
+
+/**
+ * Interned trees are not ordered by name. Rejected by main.
+ */
+template <class Tree>
+void print_leaders(OutputBuffer &, const Tree &, const char *)
+{
+}
+
+/**
+ * Writes a JSON string value, escaping quotes, backslashes and control
+ * characters.
+ */
+inline void write_json_string(FILE *file, const char *data, size_t length)
+{
+    fputc('"', file);
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = data[i];
+        if (c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * Writes height and operation counters of a red-black tree as JSON fields
+ * and resets the counters. Counters are written only if the tree is built
+ * with RBT_STATS.
+ */
+template <class Data, class Key, class Allocator>
+void write_tree_stats(FILE *file, RedBlackTree<Data, Key, Allocator> &tree)
+{
+    fprintf(file, ",\"height\":%d", tree.height());
+#ifdef RBT_STATS
+    const TreeStats &stats = tree.statistics();
+    fprintf(file, ",\"comparisons\":%llu,\"rotations\":%llu,\"recolorings\":%llu", stats.comparisons,
+            stats.rotations, stats.recolorings);
+    fprintf(file, ",\"searches\":%llu,\"avg_search_depth\":%.2f,\"max_search_depth\":%u", stats.searches,
+            stats.searches != 0 ? (double)stats.search_steps / stats.searches : 0.0, stats.max_search_depth);
+    tree.reset_statistics();
+#endif
+}
+
+/**
+ * Other backends have no counters.
+ */
+template <class Tree>
+void write_tree_stats(FILE *, Tree &)
+{
+}
+
+/**
+ * Checks a red-black tree.
+ */
+template <class Data, class Key, class Allocator>
+TreeCheck verify_players(const RedBlackTree<Data, Key, Allocator> &tree)
+{
+    return tree.verify();
+}
+
+/**
+ * Other backends are not checked. Rejected by main.
+ */
+template <class Tree>
+TreeCheck verify_players(const Tree &)
+{
+    return TreeCheck();
+}
+
+/**
+ * Removes a player from a red-black tree.
+ *
+ * @return {bool} True, removal is supported.
+ */
+template <class Data, class Key, class Allocator>
+bool erase_player(RedBlackTree<Data, Key, Allocator> &tree, Node<Data, Key> *node)
+{
+    tree.erase(node);
+    return true;
+}
+
+/**
+ * Other backends do not remove entries. Rejected by main.
+ */
+template <class Tree, class Entry>
+bool erase_player(Tree &, Entry *)
+{
+    return false;
+}
+
+/**
+ * Updates subtree maxima of a red-black tree after totals of a player are
+ * changed.
+ */
+template <class Data, class Key, class Allocator>
+void refresh_player(RedBlackTree<Data, Key, Allocator> &tree, Node<Data, Key> *node)
+{
+    tree.refresh(node);
+}
+
+/**
+ * Other backends keep no maxima.
+ */
+template <class Tree, class Entry>
+void refresh_player(Tree &, Entry *)
+{
+}
+
+/**
+ * Replaces a red-black tree with sorted players in linear time.
+ */
+template <class Data, class Key, class Allocator, class Iterator>
+void build_players(RedBlackTree<Data, Key, Allocator> &tree, Iterator first, Iterator last)
+{
+    tree.build_sorted(first, last);
+}
+
+/**
+ * Other backends insert the players one by one.
+ */
+template <class Tree, class Iterator>
+void build_players(Tree &tree, Iterator first, Iterator last)
+{
+    tree.clear();
+    for (; first != last; ++first)
+        tree.upsert(first->first, first->second);
+}
+
+/**
+ * Freezes the current version of a persistent tree.
+ *
+ * @return {bool} True, versions are supported.
+ */
+template <class Data, class Key>
+bool freeze_players(PersistentTree<Data, Key> &tree)
+{
+    tree.freeze();
+    return true;
+}
+
+/**
+ * Other backends keep only the current state.
+ */
+template <class Tree>
+bool freeze_players(Tree &)
+{
+    return false;
+}
+
+/**
+ * Sets how many of the latest frozen versions a persistent tree keeps.
+ * Older versions are dropped once no view refers to them, and the nodes
+ * copied from them are freed.
+ */
+template <class Data, class Key>
+void keep_versions(PersistentTree<Data, Key> &tree, size_t count)
+{
+    tree.keep_versions(count);
+}
+
+/**
+ * Other backends have no versions.
+ */
+template <class Tree>
+void keep_versions(Tree &, size_t)
+{
+}
+
+/**
+ * Returns index of the oldest version of a persistent tree which can still
+ * be searched.
+ */
+template <class Data, class Key>
+size_t first_version(const PersistentTree<Data, Key> &tree)
+{
+    return tree.first_version();
+}
+
+/**
+ * Other backends have no versions.
+ */
+template <class Tree>
+size_t first_version(const Tree &)
+{
+    return 0;
+}
+
+/**
+ * Publishes the latest frozen version of a persistent tree keyed by names.
+ * O(1), the view shares the nodes of the tree.
+ *
+ * @return {bool} True, views are supported.
+ */
+inline bool publish_players(ReadViewSlot &views, const PersistentTree<PlayerData, string> &tree,
+                            int season_index, const string &season)
+{
+    views.publish(make_shared<const ReadView>(season_index, season, tree.version(tree.versions() - 1)));
+    return true;
+}
+
+/**
+ * Other backends have no frozen versions, and interned keys cannot be
+ * looked up by readers. Options with views for them are rejected by
+ * check_view_options.
+ */
+template <class Tree>
+bool publish_players(ReadViewSlot &, const Tree &, int, const string &)
+{
+    return false;
+}
+
+/**
+ * Searches a frozen version of a persistent tree.
+ */
+template <class Data, class Key, class K>
+const PersistentNode<Data, Key> *search_version(const PersistentTree<Data, Key> &tree, const K &key,
+                                                size_t version)
+{
+    return tree.search(key, version);
+}
+
+/**
+ * Other backends have no versions. Rejected by main.
+ */
+template <class Tree, class K>
+const typename Tree::entry_type *search_version(const Tree &, const K &, size_t)
+{
+    return NULL;
+}
+
+/**
+ * Players of a league and their totals, updated row by row.
+ *
+ * Tree is any backend with the search/upsert/preorder/inorder contract of
+ * RedBlackTree. Its entries have key and data fields.
+ */
+template <class Keys, class Tree = RedBlackTree<PlayerData, typename Keys::key_type> >
+class League
+{
+public:
+    typedef typename Keys::key_type Key;
+    typedef typename Tree::entry_type Entry;
+
+private:
+    Keys &keys;
+    const Options &options;
+
+    Tree tree;
+    StringInterner teams;
+
+    // Scores by team code, kept if options.teams is set
+    RedBlackTree<TeamData, string> team_totals;
+
+    // Names of the seasons by index, kept if options.history is set
+    vector<string> season_names;
+
+    // Season of every frozen version of the tree, kept for options.as_of if
+    // the tree has versions. Empty for versions frozen within a season for
+    // options.publish_rows.
+    vector<string> version_seasons;
+    FieldView current_season;
+    int season_index;
+
+    // Index of the season whose end is frozen last, -1 if none is
+    int frozen_season;
+
+    // Name of the season loaded from a snapshot, current_season points here
+    string loaded_season;
+
+    // Reports of the loaded season were printed by the run that saved it
+    bool season_reported;
+
+    // Destination of options.stats, start time and row count of the season
+    FILE *stats_file;
+    chrono::steady_clock::time_point season_start;
+    unsigned int season_rows;
+
+    // Inserts since the tree was last checked, for options.verify, and
+    // whether every check passed
+    unsigned int unverified_inserts;
+    bool tree_valid;
+
+    // Totals only increase, so the maxima are replaced only when another
+    // player passes them. Removed players keep their maxima.
+    MaxScore<Key> max_point;
+    MaxScore<Key> max_assist;
+    MaxScore<Key> max_rebound;
+
+    // Players ordered by total scores, kept if options.top is set
+    Leaderboard<Entry> top_point, top_assist, top_rebound;
+
+    // Players with a row in each season, kept if options.retire is set
+    vector<vector<Entry *> > season_players;
+
+    // Latest view for reader threads, kept if options.publish_views is set,
+    // and rows added since it was published
+    ReadViewSlot views;
+    unsigned int unpublished_rows;
+
+    // Writer thread of the dumps, NULL if they are written by this thread
+    ReportWriter *report_writer;
+
+    League(const League &);
+    League &operator=(const League &);
+
+    /**
+     * Tree visitor which writes players to a snapshot.
+     */
+    struct PlayerWriter
+    {
+        SnapshotWriter &writer;
+        const Keys &keys;
+
+        PlayerWriter(SnapshotWriter &writer, const Keys &keys) : writer(writer), keys(keys)
+        {
+        }
+
+        void operator()(const Entry *entry)
+        {
+            const PlayerData &data = entry->data;
+            writer.write_string(keys.name(entry->key));
+            writer.write((int)data.team);
+            writer.write(data.point);
+            writer.write(data.total_point);
+            writer.write(data.rebound);
+            writer.write(data.total_rebound);
+            writer.write(data.assist);
+            writer.write(data.total_assist);
+            writer.write(data.last_season);
+            writer.write_block(data.history.data(), data.history.size());
+        }
+    };
+
+    /**
+     * Tree visitor which adds loaded players to the leaderboards and the
+     * retire buckets.
+     */
+    struct IndexBuilder
+    {
+        League &league;
+
+        IndexBuilder(League &league) : league(league)
+        {
+        }
+
+        void operator()(Entry *entry)
+        {
+            const PlayerData &data = entry->data;
+            if (league.options.top != 0)
+            {
+                league.top_point.insert(entry, data.total_point);
+                league.top_assist.insert(entry, data.total_assist);
+                league.top_rebound.insert(entry, data.total_rebound);
+            }
+            if (league.options.retire > 0 && data.last_season >= 0 && data.last_season <= league.season_index)
+                league.season_players[data.last_season].push_back(entry);
+        }
+    };
+
+    /**
+     * Publishes the latest frozen version of the players for reader threads.
+     * O(1). Needs a PersistentTree keyed by names, nothing is published
+     * otherwise.
+     */
+    void publish_view()
+    {
+        publish_players(views, tree, season_index, current_season.str());
+        unpublished_rows = 0;
+    }
+
+    /**
+     * Writes a JSON line with the timings and tree counters of the current
+     * season: time spent adding its rows and time spent on its reports.
+     *
+     * @param reports_start {time_point} End of the rows, start of the reports.
+     */
+    void write_season_stats(chrono::steady_clock::time_point reports_start)
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        double rows_ms = chrono::duration_cast<chrono::microseconds>(reports_start - season_start).count() / 1000.0;
+        double reports_ms = chrono::duration_cast<chrono::microseconds>(now - reports_start).count() / 1000.0;
+
+        fprintf(stats_file, "{\"season\":");
+        write_json_string(stats_file, current_season.data, current_season.length);
+        fprintf(stats_file, ",\"index\":%d,\"rows\":%u,\"players\":%u,\"rows_ms\":%.3f,\"reports_ms\":%.3f",
+                season_index, season_rows, (unsigned int)tree.size(), rows_ms, reports_ms);
+        write_tree_stats(stats_file, tree);
+        fprintf(stats_file, "}\n");
+        fflush(stats_file);
+    }
+
+    /**
+     * Checks the tree. A broken tree means corrupt totals from now on, so
+     * the violation and the season are printed and valid() turns false.
+     */
+    void verify_tree()
+    {
+        TreeCheck check = verify_players(tree);
+        if (!check.valid)
+        {
+            cerr << "Tree is invalid in season " << current_season << " after " << tree.size()
+                 << " players: " << check.error << endl;
+            tree_valid = false;
+        }
+    }
+
+    /**
+     * Prints season and total scores of every team, ordered by team code.
+     * Season scores are zero for teams without a row in the season.
+     */
+    void print_team_totals(OutputBuffer &out) const
+    {
+        out << "Team Totals:\n";
+
+        RedBlackTree<TeamData, string>::iterator it = team_totals.begin();
+        for (; it != team_totals.end(); ++it)
+        {
+            const TeamData &team = it->data;
+            bool active = team.season == season_index;
+
+            out << it->key << " - Points: " << (active ? team.point : 0) << "/" << team.total_point
+                << " Assists: " << (active ? team.assist : 0) << "/" << team.total_assist
+                << " Rebs: " << (active ? team.rebound : 0) << "/" << team.total_rebound << '\n';
+        }
+    }
+
+    /**
+     * Season visitor which prints the scores of a season.
+     */
+    struct SeasonPrinter
+    {
+        OutputBuffer &out;
+        const vector<string> &season_names;
+
+        SeasonPrinter(OutputBuffer &out, const vector<string> &season_names)
+            : out(out), season_names(season_names)
+        {
+        }
+
+        void operator()(const SeasonHistory::Season &season)
+        {
+            if ((size_t)season.season < season_names.size() && !season_names[season.season].empty())
+                out << season_names[season.season];
+            else
+                out << "Season " << season.season + 1;
+
+            out << " - Points: " << season.point << " Assists: " << season.assist
+                << " Rebs: " << season.rebound << '\n';
+        }
+    };
+
+    /**
+     * Prints the scores of every season of a player.
+     *
+     * @param out {OutputBuffer} Destination of the report.
+     * @param name {const char*} Name of the player.
+     */
+    void print_career(OutputBuffer &out, const char *name)
+    {
+        out << "Seasons of " << name << ":\n";
+
+        Entry *entry = tree.search(keys.key(FieldView(name, strlen(name))));
+        if (entry == NULL)
+        {
+            out << "Player not found\n";
+            return;
+        }
+
+        SeasonPrinter print_season(out, season_names);
+        entry->data.history.for_each(print_season);
+    }
+
+    /**
+     * Freezes the state at the end of the current season, if the tree has
+     * versions.
+     */
+    void freeze_season()
+    {
+        if (current_season.length == 0 || frozen_season == season_index)
+            return;
+
+        if (freeze_players(tree) && options.as_of != NULL)
+            version_seasons.push_back(current_season.str());
+        frozen_season = season_index;
+    }
+
+    /**
+     * Reopens the season loaded from a snapshot when more of its rows are
+     * added. The version frozen at the load becomes one within the season.
+     */
+    void resume_season()
+    {
+        season_reported = false;
+        if (frozen_season != season_index)
+            return;
+
+        if (!version_seasons.empty() && version_seasons.back() == current_season.str())
+            version_seasons.back().clear();
+        frozen_season = -1;
+    }
+
+    /**
+     * Prints total scores of a player at the end of a season, from the
+     * version of that season. O(s + log n) for s seasons.
+     *
+     * @param out {OutputBuffer} Destination of the report.
+     * @param query {const char*} Season and name of the player, separated
+     * by a comma.
+     */
+    void print_as_of(OutputBuffer &out, const char *query)
+    {
+        const char *comma = strchr(query, ',');
+        string season = comma != NULL ? string(query, comma - query) : string(query);
+        const char *name = comma != NULL ? comma + 1 : "";
+
+        out << name << " as of " << season;
+
+        // Versions frozen within a season have no name
+        size_t version = 0;
+        while (version < version_seasons.size() && version_seasons[version] != season)
+            version++;
+        if (season.empty() || version == version_seasons.size())
+        {
+            out << " - Season not found\n";
+            return;
+        }
+        if (version < first_version(tree))
+        {
+            out << " - Season no longer kept\n";
+            return;
+        }
+
+        const Entry *entry = search_version(tree, keys.key(FieldView(name, strlen(name))), version);
+        if (entry == NULL)
+        {
+            out << " - Player not found\n";
+            return;
+        }
+
+        out << " - Points: " << entry->data.total_point << " Assists: " << entry->data.total_assist
+            << " Rebs: " << entry->data.total_rebound << '\n';
+    }
+
+    /**
+     * Prints the first k players of a leaderboard.
+     */
+    void print_leaderboard(OutputBuffer &out, const char *title,
+                           const Leaderboard<Entry> &board) const
+    {
+        vector<pair<const Entry *, int> > top;
+        board.top(options.top, top);
+
+        out << "Top " << (unsigned int)options.top << " " << title << ":\n";
+        for (size_t i = 0; i < top.size(); i++)
+            out << (unsigned int)(i + 1) << ". " << keys.name(top[i].first->key) << " - " << top[i].second << '\n';
+    }
+
+    /**
+     * Removes players without a row in the last options.retire seasons.
+     * Called at the start of every season, so only the players whose last
+     * season is just outside the window have to be checked.
+     */
+    void retire_players()
+    {
+        int season = season_index - options.retire - 1;
+        if (season < 0)
+            return;
+
+        vector<Entry *> &players = season_players[season];
+
+        // Names of removed players may still be in a dump being written
+        if (report_writer != NULL && !players.empty())
+            report_writer->wait();
+
+        for (size_t i = 0; i < players.size(); i++)
+        {
+            Entry *node = players[i];
+            if (node->data.last_season != season)
+                continue;
+
+            if (options.top != 0)
+            {
+                top_point.erase(node, node->data.total_point);
+                top_assist.erase(node, node->data.total_assist);
+                top_rebound.erase(node, node->data.total_rebound);
+            }
+            erase_player(tree, node);
+        }
+
+        // Removals rebalance the tree too
+        if (options.verify != 0 && !players.empty())
+            verify_tree();
+
+        vector<Entry *>().swap(players);
+    }
+
+public:
+    /**
+     * @param keys {Keys} Maps player names to tree keys and back.
+     * @param options {Options} Command line options.
+     */
+    League(Keys &keys, const Options &options)
+        : keys(keys), options(options), season_index(-1), frozen_season(-1), season_reported(false),
+          stats_file(NULL), season_rows(0), unverified_inserts(0), tree_valid(true), unpublished_rows(0),
+          report_writer(NULL)
+    {
+        // Only options.as_of searches old versions, views keep their own
+        // versions alive
+        if (options.as_of == NULL)
+            keep_versions(tree, 0);
+        else
+            keep_versions(tree, options.keep_versions != 0 ? options.keep_versions : (size_t)-1);
+
+        if (options.stats != NULL)
+        {
+            stats_file = fopen(options.stats, "w");
+            if (stats_file == NULL)
+                cerr << "Stats file cannot be opened: " << options.stats << endl;
+        }
+    }
+
+    ~League()
+    {
+        if (stats_file != NULL)
+            fclose(stats_file);
+    }
+
+    /**
+     * Returns false once a check for options.verify found the tree broken.
+     * No more rows or reports should be added then.
+     */
+    bool valid() const
+    {
+        return tree_valid;
+    }
+
+    /**
+     * Returns name of the current season. Empty before the first row.
+     */
+    const FieldView &season() const
+    {
+        return current_season;
+    }
+
+    /**
+     * Returns number of rows of the current season added so far, including
+     * the rows of a loaded snapshot. Zero for a snapshot that does not
+     * record it.
+     */
+    unsigned int season_row_count() const
+    {
+        return season_rows;
+    }
+
+    /**
+     * Returns the player tree.
+     */
+    Tree &players()
+    {
+        return tree;
+    }
+
+    /**
+     * Hands the tree dumps to a writer thread instead of writing them. The
+     * dumps are recorded, so the tree can be changed while they are written.
+     * The OutputBuffer given to the other methods must write to the same
+     * writer, so the dumps stay in order with the other reports.
+     *
+     * @param writer {ReportWriter} Writer thread. Must stay alive while the
+     * league reports.
+     */
+    void defer_dumps(ReportWriter &writer)
+    {
+        report_writer = &writer;
+    }
+
+    /**
+     * Returns the latest published view of the players. Can be used from
+     * any thread while rows are added.
+     */
+    const ReadViewSlot &read_views() const
+    {
+        return views;
+    }
+
+    /**
+     * Starts a new season. Removes inactive players if options.retire is set.
+     *
+     * @param season {FieldView} Name of the new season.
+     */
+    void start_season(const FieldView &season)
+    {
+        current_season = season;
+        season_index++;
+
+        if (options.history)
+        {
+            // Seasons before a loaded snapshot without names stay unnamed
+            season_names.resize(season_index);
+            season_names.push_back(season.str());
+        }
+        season_start = chrono::steady_clock::now();
+        season_rows = 0;
+
+        if (options.retire > 0)
+        {
+            season_players.push_back(vector<Entry *>());
+            retire_players();
+        }
+    }
+
+    /**
+     * Adds a row of the current season.
+     *
+     * @param row {CsvRow} Row of the csv file.
+     */
+    void add(const CsvRow &row)
+    {
+        season_rows++;
+
+        // The snapshot was cut within its season, which is reported and
+        // frozen again at its end
+        if (season_reported)
+            resume_season();
+
+        // Find the player in the tree, insert if not found. The name is
+        // copied into the key of a new node only, and the data is moved
+        unsigned int team = teams.intern(row.team.data, row.team.length);
+        pair<Entry *, bool> result =
+            tree.upsert(keys.key(row.name), PlayerData(team, row.point, row.rebound, row.assist));
+        Entry *node = result.first;
+
+        if (result.second && options.verify != 0 && ++unverified_inserts == options.verify)
+        {
+            verify_tree();
+            unverified_inserts = 0;
+        }
+
+        if (options.retire > 0 && (result.second || node->data.last_season != season_index))
+            season_players[season_index].push_back(node);
+
+        if (!result.second)
+        {
+            // User is found in the tree, will be updated
+            node->data.update(row.point, row.assist, row.rebound);
+            node->data.team = team;
+            refresh_player(tree, node);
+        }
+        node->data.last_season = season_index;
+
+        if (options.history)
+            node->data.history.add(season_index, row.point, row.assist, row.rebound);
+
+        if (options.teams)
+        {
+            // Same key for every row of a team, the code is copied only once
+            Node<TeamData, string> *team = team_totals.upsert(row.team, TeamData()).first;
+            team->data.add(season_index, row.point, row.assist, row.rebound);
+        }
+
+        if (options.top != 0)
+        {
+            if (result.second)
+            {
+                top_point.insert(node, node->data.total_point);
+                top_assist.insert(node, node->data.total_assist);
+                top_rebound.insert(node, node->data.total_rebound);
+            }
+            else
+            {
+                top_point.update(node, node->data.total_point - row.point, node->data.total_point);
+                top_assist.update(node, node->data.total_assist - row.assist, node->data.total_assist);
+                top_rebound.update(node, node->data.total_rebound - row.rebound, node->data.total_rebound);
+            }
+        }
+
+        // Update max point, rebound and assit
+        max_assist.update(node->data.total_assist, node->key);
+        max_point.update(node->data.total_point, node->key);
+        max_rebound.update(node->data.total_rebound, node->key);
+
+        // Readers see the season so far, from a version that is not a
+        // season end
+        if (options.publish_views && options.publish_rows != 0 &&
+            ++unpublished_rows == options.publish_rows && freeze_players(tree))
+        {
+            if (options.as_of != NULL)
+                version_seasons.push_back(string());
+            publish_view();
+        }
+    }
+
+    /**
+     * Prints max's and leaderboards of the current season.
+     *
+     * @param out {OutputBuffer} Destination of the report.
+     */
+    void print_season_end(OutputBuffer &out) const
+    {
+        out << "End of the ";
+        out.write(current_season.data, current_season.length);
+        out << " Season\n";
+
+        out << "Max Points: " << max_point.value << " - Player Name: "
+            << (max_point.found ? keys.name(max_point.key) : "") << '\n';
+        out << "Max Assists: " << max_assist.value << " - Player Name: "
+            << (max_assist.found ? keys.name(max_assist.key) : "") << '\n';
+        out << "Max Rebs: " << max_rebound.value << " - Player Name: "
+            << (max_rebound.found ? keys.name(max_rebound.key) : "") << '\n';
+
+        if (options.top != 0)
+        {
+            print_leaderboard(out, "Points", top_point);
+            print_leaderboard(out, "Assists", top_assist);
+            print_leaderboard(out, "Rebs", top_rebound);
+        }
+
+        if (options.teams)
+            print_team_totals(out);
+    }
+
+    /**
+     * Dumps the tree in the format given by options.dump_mode, or hands a
+     * recorded dump to the writer given to defer_dumps.
+     *
+     * @param out {OutputBuffer} Destination of the dump.
+     */
+    void dump(OutputBuffer &out)
+    {
+        if (report_writer != NULL && options.dump_mode != DUMP_OFF)
+        {
+            vector<DumpEntry> entries;
+            entries.reserve(tree.size());
+            record_dump(tree, keys, options.dump_mode, season_index, entries);
+
+            // Reports before the dump are handed over first
+            out.flush();
+            report_writer->write_dump(options.dump_mode, entries);
+            return;
+        }
+
+        dump_tree(tree, out, keys, options.dump_mode, season_index);
+    }
+
+    /**
+     * Prints the reports of the finished season and writes the snapshot if
+     * requested. Called when a new season starts.
+     *
+     * @param out {OutputBuffer} Destination of the reports.
+     */
+    void end_season(OutputBuffer &out)
+    {
+        // Reports of the loaded season are skipped
+        freeze_season();
+
+        if (season_reported)
+        {
+            season_reported = false;
+            return;
+        }
+
+        chrono::steady_clock::time_point reports_start = chrono::steady_clock::now();
+
+        if (current_season.length != 0)
+        {
+            // Print the situation
+            print_season_end(out);
+        }
+
+        dump(out);
+
+        if (options.save != NULL && current_season.length != 0)
+            save_snapshot(options.save);
+
+        if (options.publish_views && current_season.length != 0)
+            publish_view();
+
+        if (stats_file != NULL && current_season.length != 0)
+            write_season_stats(reports_start);
+    }
+
+    /**
+     * Prints the reports of the last season and the reports requested for
+     * the end of the input.
+     *
+     * @param out {OutputBuffer} Destination of the reports.
+     */
+    void finish(OutputBuffer &out)
+    {
+        chrono::steady_clock::time_point reports_start = chrono::steady_clock::now();
+
+        freeze_season();
+
+        // Print last season data
+        print_season_end(out);
+        dump(out);
+
+        if (options.save != NULL)
+            save_snapshot(options.save);
+
+        if (options.publish_views)
+            publish_view();
+
+        if (stats_file != NULL)
+            write_season_stats(reports_start);
+
+        if (options.prefix != NULL)
+            print_prefix(out, tree, options.prefix);
+
+        if (options.career != NULL)
+            print_career(out, options.career);
+
+        if (options.as_of != NULL)
+            print_as_of(out, options.as_of);
+
+        if (options.leaders != NULL)
+            print_leaders(out, tree, options.leaders);
+    }
+
+    /**
+     * Writes the state at the end of the current season to a snapshot.
+     *
+     * Format: magic "RBTS", version {uint32}, ordered by name {uint8},
+     * season index {int32}, season {string}, team count {uint32} and team
+     * codes by id, three maxima (value {int32}, found {uint8}, name
+     * {string}), player count {uint32} and the players in tree order (name
+     * {string}, then team, point, total_point, rebound, total_rebound,
+     * assist, total_assist, last_season, each {int32}), team total count
+     * {uint32} and the team totals ordered by code (code {string}, then
+     * season, rows, point, total_point, rebound, total_rebound, assist,
+     * total_assist, each {int32}), season name count {uint32} and the
+     * season names by index. Since version 3 every player ends with its
+     * season history (length {uint32} and the SeasonHistory bytes).
+     * Since version 4 the snapshot ends with the number of rows of the
+     * season read {uint32}, so a run cut within a season resumes at the
+     * next row. Version 2 snapshots end after the team totals, version 1
+     * snapshots after the players.
+     *
+     * @param path {const char*} Path of the snapshot.
+     *
+     * @return {bool} False if the file cannot be written.
+     */
+    bool save_snapshot(const char *path)
+    {
+        SnapshotWriter writer(path);
+
+        writer.write(SNAPSHOT_MAGIC);
+        writer.write(SNAPSHOT_VERSION);
+        writer.write((unsigned char)Keys::ordered_by_name);
+        writer.write((int)season_index);
+        writer.write_string(current_season.data, current_season.length);
+
+        writer.write((unsigned int)teams.size());
+        for (unsigned int i = 0; i < teams.size(); i++)
+            writer.write_string(teams.str(i));
+
+        const MaxScore<Key> *maxima[] = {&max_point, &max_assist, &max_rebound};
+        for (int i = 0; i < 3; i++)
+        {
+            writer.write((int)maxima[i]->value);
+            writer.write((unsigned char)maxima[i]->found);
+            writer.write_string(maxima[i]->found ? keys.name(maxima[i]->key) : string());
+        }
+
+        writer.write((unsigned int)tree.size());
+        PlayerWriter write_player(writer, keys);
+        tree.inorder(write_player);
+
+        writer.write((unsigned int)team_totals.size());
+        RedBlackTree<TeamData, string>::iterator it = team_totals.begin();
+        for (; it != team_totals.end(); ++it)
+        {
+            const TeamData &team = it->data;
+            writer.write_string(it->key);
+            writer.write(team.season);
+            writer.write(team.rows);
+            writer.write(team.point);
+            writer.write(team.total_point);
+            writer.write(team.rebound);
+            writer.write(team.total_rebound);
+            writer.write(team.assist);
+            writer.write(team.total_assist);
+        }
+
+        writer.write((unsigned int)season_names.size());
+        for (size_t i = 0; i < season_names.size(); i++)
+            writer.write_string(season_names[i]);
+
+        writer.write(season_rows);
+
+        if (!writer.commit())
+        {
+            cerr << "Snapshot cannot be written: " << path << endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Replaces the state with a snapshot. Should be called before any row
+     * is added. A red-black tree is built in linear time from the sorted
+     * players.
+     *
+     * @param data {const char*} Start of the snapshot, e.g. a mapped file.
+     * @param length {size_t} Length of the snapshot.
+     *
+     * @return {bool} False if the snapshot is invalid, e.g. its players are
+     * not in strictly increasing key order, or was written with a different
+     * key mapping.
+     */
+    bool load_snapshot(const char *data, size_t length)
+    {
+        SnapshotReader reader(data, length);
+        const char *str;
+        size_t str_length;
+
+        if (reader.read<unsigned int>() != SNAPSHOT_MAGIC)
+            return false;
+
+        unsigned int version = reader.read<unsigned int>();
+        if (version < 1 || version > SNAPSHOT_VERSION ||
+            reader.read<unsigned char>() != (unsigned char)Keys::ordered_by_name)
+            return false;
+
+        season_index = reader.read<int>();
+        str_length = reader.read_string(str);
+        loaded_season.assign(str, str_length);
+        current_season = FieldView(loaded_season.data(), loaded_season.length());
+
+        unsigned int team_count = reader.read<unsigned int>();
+        for (unsigned int i = 0; i < team_count && !reader.fail(); i++)
+        {
+            str_length = reader.read_string(str);
+            teams.intern(str, str_length);
+        }
+
+        // Names of the maxima are mapped after the players, so interned ids
+        // of the players follow tree order
+        MaxScore<Key> *maxima[] = {&max_point, &max_assist, &max_rebound};
+        FieldView max_names[3];
+        for (int i = 0; i < 3; i++)
+        {
+            maxima[i]->value = reader.read<int>();
+            maxima[i]->found = reader.read<unsigned char>() != 0;
+            str_length = reader.read_string(str);
+            max_names[i] = FieldView(str, str_length);
+        }
+
+        unsigned int player_count = reader.read<unsigned int>();
+        vector<pair<Key, PlayerData> > players;
+        for (unsigned int i = 0; i < player_count && !reader.fail(); i++)
+        {
+            const char *name;
+            size_t name_length = reader.read_string(name);
+            PlayerData data;
+            data.team = reader.read<int>();
+            data.point = reader.read<int>();
+            data.total_point = reader.read<int>();
+            data.rebound = reader.read<int>();
+            data.total_rebound = reader.read<int>();
+            data.assist = reader.read<int>();
+            data.total_assist = reader.read<int>();
+            data.last_season = reader.read<int>();
+            if (version >= 3)
+            {
+                str_length = reader.read_block(str);
+                data.history.assign((const unsigned char *)str, str_length);
+            }
+            // Players are built into the tree as given, so they must be in
+            // key order
+            Key key(keys.key(FieldView(name, name_length)));
+            if (!players.empty() && !(players.back().first < key))
+                return false;
+            players.push_back(make_pair(std::move(key), std::move(data)));
+        }
+
+        vector<pair<string, TeamData> > team_list;
+        unsigned int team_total_count = version >= 2 ? reader.read<unsigned int>() : 0;
+        for (unsigned int i = 0; i < team_total_count && !reader.fail(); i++)
+        {
+            str_length = reader.read_string(str);
+            TeamData team;
+            team.season = reader.read<int>();
+            team.rows = reader.read<int>();
+            team.point = reader.read<int>();
+            team.total_point = reader.read<int>();
+            team.rebound = reader.read<int>();
+            team.total_rebound = reader.read<int>();
+            team.assist = reader.read<int>();
+            team.total_assist = reader.read<int>();
+            team_list.push_back(make_pair(string(str, str_length), team));
+        }
+
+        unsigned int season_count = version >= 3 ? reader.read<unsigned int>() : 0;
+        for (unsigned int i = 0; i < season_count && !reader.fail(); i++)
+        {
+            str_length = reader.read_string(str);
+            season_names.push_back(string(str, str_length));
+        }
+
+        // Zero if unknown, the whole season is then skipped
+        season_rows = version >= 4 ? reader.read<unsigned int>() : 0;
+
+        if (reader.fail() || season_index < 0)
+            return false;
+
+        team_totals.build_sorted(team_list.begin(), team_list.end());
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (maxima[i]->found)
+                maxima[i]->key = keys.key(max_names[i]);
+        }
+
+        build_players(tree, players.begin(), players.end());
+
+        // Rebuild the indexes from the tree
+        if (options.retire > 0)
+            season_players.resize(season_index + 1);
+
+        IndexBuilder index_player(*this);
+        tree.inorder(index_player);
+
+        // The loaded season is frozen here, end_season does not freeze it
+        // again
+        freeze_season();
+        if (options.publish_views)
+            publish_view();
+
+        season_reported = true;
+        return true;
+    }
+};
+
+#endif
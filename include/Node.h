@@ -5,34 +5,89 @@
 #ifndef NODE_H
 #define NODE_H
 
+#include <cstddef> // NULL
+#include <utility> // forward
+
+#include "SubtreeMax.h"
+
 enum Color
 {
     RED,
     BLACK,
 };
 
-template <class Data, class Key>
-struct Node
+/**
+ * Links, color, subtree size and subtree maxima of a Node.
+ */
+template <class Self, class Data, bool = SubtreeMax<Data>::enabled>
+struct NodeLinks
 {
-    Node *parent, *left, *right;
+    Self *parent, *left, *right;
     Color color;
+    unsigned int size;            // Number of nodes in the subtree rooted here
+    SubtreeMax<Data> subtree_max; // Maxima of the subtree rooted here
+
+    NodeLinks(Color color) : parent(NULL), left(NULL), right(NULL), color(color), size(1)
+    {
+    }
+
+    SubtreeMax<Data> &max()
+    {
+        return subtree_max;
+    }
+
+    const SubtreeMax<Data> &max() const
+    {
+        return subtree_max;
+    }
+};
+
+/**
+ * Data with nothing to keep. The empty SubtreeMax is a base placed before
+ * the links, so it adds no bytes to the node.
+ */
+template <class Self, class Data>
+struct NodeLinks<Self, Data, false> : private SubtreeMax<Data>
+{
+    Self *parent, *left, *right;
+    Color color;
+    unsigned int size; // Number of nodes in the subtree rooted here
+
+    NodeLinks(Color color) : parent(NULL), left(NULL), right(NULL), color(color), size(1)
+    {
+    }
+
+    SubtreeMax<Data> &max()
+    {
+        return *this;
+    }
+
+    const SubtreeMax<Data> &max() const
+    {
+        return *this;
+    }
+};
+
+template <class Data, class Key>
+struct Node : NodeLinks<Node<Data, Key>, Data>
+{
     Key key;
     Data data;
 
     /**
-     * Node constructor. Default color is red.
+     * Node constructor. Default color is red. Data and key are built in
+     * place from the arguments, so temporaries are moved, not copied.
      * 
-     * @param node_data {Data} Data of the node.
-     * @param node_key {Key} Key of the node. Will be used to identify the node.
+     * @param node_data {D} Data of the node, or a value Data is built from.
+     * @param node_key {K} Key of the node, or a value Key is built from,
+     * e.g. a FieldView for a string key. Will be used to identify the node.
      */
-    Node(Data node_data, Key node_key, Color node_color = RED)
+    template <class D, class K>
+    Node(D &&node_data, K &&node_key, Color node_color = RED)
+        : NodeLinks<Node, Data>(node_color), key(std::forward<K>(node_key)),
+          data(std::forward<D>(node_data))
     {
-        data = node_data;
-        key = node_key;
-        color = node_color;
-        parent = NULL;
-        left = NULL;
-        right = NULL;
+        this->max().reset(data);
     }
 
     /**
@@ -48,10 +103,10 @@ struct Node
      */
     void toggle_color()
     {
-        if (color == BLACK)
-            color = RED;
+        if (this->color == BLACK)
+            this->color = RED;
         else
-            color = BLACK;
+            this->color = BLACK;
     }
 
     /**
@@ -61,7 +116,7 @@ struct Node
      */
     bool is_black()
     {
-        return color == BLACK;
+        return this->color == BLACK;
     }
 
     /**
@@ -71,7 +126,7 @@ struct Node
      */
     bool is_red()
     {
-        return color == RED;
+        return this->color == RED;
     }
 };
 
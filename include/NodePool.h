@@ -0,0 +1,190 @@
+/**
+ * Allocation policies for RedBlackTree nodes.
+ *
+ * A policy creates and destroys single nodes and may be able to free all of
+ * its nodes at once. RedBlackTree uses NodePool by default.
+ */
+
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <algorithm> // sort, binary_search
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility> // forward
+#include <vector>
+
+/**
+ * Allocates every node separately with new and delete.
+ */
+template <class T>
+class HeapAllocator
+{
+public:
+    /**
+     * Allocates and constructs a single object.
+     */
+    template <class... Args>
+    T *create(Args &&... args)
+    {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Destructs and deallocates a single object.
+     */
+    void destroy(T *ptr)
+    {
+        delete ptr;
+    }
+
+    /**
+     * Heap allocator does not keep track of its objects.
+     *
+     * @return {bool} Always false, objects should be destroyed one by one.
+     */
+    bool release_all()
+    {
+        return false;
+    }
+};
+
+/**
+ * Arena allocator. Objects are placed in large contiguous slabs, which are
+ * freed together by release_all. Destroyed objects are reused by later calls
+ * to create.
+ */
+template <class T>
+class NodePool
+{
+private:
+    static const size_t MIN_SLAB_SIZE = 64;
+    static const size_t MAX_SLAB_SIZE = 1 << 16;
+
+    // Raw memory of the slabs and their capacities
+    std::vector<T *> slabs;
+    std::vector<size_t> slab_sizes;
+
+    // Next unused slot of the last slab
+    size_t used;
+
+    // Destroyed objects, available for reuse
+    std::vector<T *> free_slots;
+
+    NodePool(const NodePool &);
+    NodePool &operator=(const NodePool &);
+
+    /**
+     * Allocates a new slab. Slab sizes grow geometrically.
+     */
+    void add_slab()
+    {
+        size_t size = slab_sizes.empty() ? MIN_SLAB_SIZE : slab_sizes.back() * 2;
+        if (size > MAX_SLAB_SIZE)
+            size = MAX_SLAB_SIZE;
+
+        slabs.push_back(static_cast<T *>(::operator new(size * sizeof(T))));
+        slab_sizes.push_back(size);
+        used = 0;
+    }
+
+    /**
+     * Returns memory for a single object.
+     */
+    T *allocate()
+    {
+        if (!free_slots.empty())
+        {
+            T *ptr = free_slots.back();
+            free_slots.pop_back();
+            return ptr;
+        }
+
+        if (slabs.empty() || used == slab_sizes.back())
+            add_slab();
+
+        return slabs.back() + used++;
+    }
+
+    /**
+     * Calls destructors of live objects. Skipped for trivially destructible
+     * types.
+     */
+    void destroy_live()
+    {
+        if (std::is_trivially_destructible<T>::value)
+            return;
+
+        std::sort(free_slots.begin(), free_slots.end());
+
+        for (size_t i = 0; i < slabs.size(); i++)
+        {
+            size_t count = (i + 1 == slabs.size()) ? used : slab_sizes[i];
+            for (size_t j = 0; j < count; j++)
+            {
+                T *ptr = slabs[i] + j;
+                if (!std::binary_search(free_slots.begin(), free_slots.end(), ptr))
+                    ptr->~T();
+            }
+        }
+    }
+
+public:
+    NodePool() : used(0)
+    {
+    }
+
+    ~NodePool()
+    {
+        release_all();
+    }
+
+    /**
+     * Constructs a single object in the pool.
+     */
+    template <class... Args>
+    T *create(Args &&... args)
+    {
+        T *ptr = allocate();
+        try
+        {
+            return new (ptr) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            free_slots.push_back(ptr);
+            throw;
+        }
+    }
+
+    /**
+     * Destructs a single object. Its memory is kept for reuse.
+     */
+    void destroy(T *ptr)
+    {
+        ptr->~T();
+        free_slots.push_back(ptr);
+    }
+
+    /**
+     * Destructs all objects and frees every slab.
+     *
+     * @return {bool} Always true.
+     */
+    bool release_all()
+    {
+        destroy_live();
+
+        for (size_t i = 0; i < slabs.size(); i++)
+            ::operator delete(slabs[i]);
+
+        slabs.clear();
+        slab_sizes.clear();
+        free_slots.clear();
+        used = 0;
+        return true;
+    }
+};
+
+#endif
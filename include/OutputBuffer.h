@@ -0,0 +1,197 @@
+/**
+ * OutputBuffer class.
+ */
+
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <cstdio>  // fwrite
+#include <cstring> // memcpy, strlen
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Destination of an OutputBuffer other than a file, e.g. a queue to the
+ * thread which writes the output.
+ */
+class OutputSink
+{
+public:
+    virtual ~OutputSink()
+    {
+    }
+
+    /**
+     * Takes a chunk of output. The data is valid only during the call.
+     */
+    virtual void consume(const char *data, size_t length) = 0;
+};
+
+/**
+ * Collects output in a large buffer and writes it to a file in big chunks.
+ * Nothing is flushed per line.
+ */
+class OutputBuffer
+{
+private:
+    FILE *file;
+    OutputSink *sink; // Used instead of file if not NULL
+    vector<char> buffer;
+    size_t used;
+
+    OutputBuffer(const OutputBuffer &);
+    OutputBuffer &operator=(const OutputBuffer &);
+
+public:
+    /**
+     * @param file {FILE*} Destination of the output.
+     * @param capacity {size_t} Size of the buffer in bytes.
+     */
+    OutputBuffer(FILE *file, size_t capacity = 1 << 20)
+        : file(file), sink(NULL), buffer(capacity), used(0)
+    {
+    }
+
+    /**
+     * @param sink {OutputSink} Destination of the output. Must outlive the
+     * buffer.
+     * @param capacity {size_t} Size of the buffer in bytes.
+     */
+    OutputBuffer(OutputSink &sink, size_t capacity = 1 << 20)
+        : file(NULL), sink(&sink), buffer(capacity), used(0)
+    {
+    }
+
+    ~OutputBuffer()
+    {
+        flush();
+    }
+
+    /**
+     * Writes buffered output to the file or hands it to the sink.
+     */
+    void flush()
+    {
+        if (sink != NULL)
+        {
+            if (used != 0)
+                sink->consume(&buffer[0], used);
+            used = 0;
+            return;
+        }
+
+        if (used != 0)
+        {
+            fwrite(&buffer[0], 1, used, file);
+            used = 0;
+        }
+        fflush(file);
+    }
+
+    /**
+     * Appends raw bytes.
+     */
+    void write(const char *data, size_t length)
+    {
+        if (length == 0)
+            return;
+
+        if (used + length > buffer.size())
+        {
+            flush();
+
+            // Larger than the whole buffer, write directly
+            if (length > buffer.size())
+            {
+                if (sink != NULL)
+                    sink->consume(data, length);
+                else
+                    fwrite(data, 1, length, file);
+                return;
+            }
+        }
+        memcpy(&buffer[used], data, length);
+        used += length;
+    }
+
+    /**
+     * Appends a character count times.
+     */
+    void fill(char c, size_t count)
+    {
+        while (count != 0)
+        {
+            if (used == buffer.size())
+                flush();
+
+            size_t n = buffer.size() - used;
+            if (n > count)
+                n = count;
+            memset(&buffer[used], c, n);
+            used += n;
+            count -= n;
+        }
+    }
+
+    /**
+     * Appends a value in native byte order. Used for binary output.
+     */
+    template <class T>
+    void write_raw(const T &value)
+    {
+        write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    OutputBuffer &operator<<(char c)
+    {
+        if (used == buffer.size())
+            flush();
+        buffer[used++] = c;
+        return *this;
+    }
+
+    OutputBuffer &operator<<(const char *str)
+    {
+        write(str, strlen(str));
+        return *this;
+    }
+
+    OutputBuffer &operator<<(const string &str)
+    {
+        write(str.data(), str.length());
+        return *this;
+    }
+
+    OutputBuffer &operator<<(long long value)
+    {
+        char digits[24];
+        int pos = sizeof(digits);
+        unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : value;
+
+        do
+        {
+            digits[--pos] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (value < 0)
+            digits[--pos] = '-';
+
+        write(digits + pos, sizeof(digits) - pos);
+        return *this;
+    }
+
+    OutputBuffer &operator<<(int value)
+    {
+        return *this << (long long)value;
+    }
+
+    OutputBuffer &operator<<(unsigned int value)
+    {
+        return *this << (long long)value;
+    }
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * Parses a csv file on several threads. The file is split at season
+ * boundaries into parts of about PART_BYTES and every part is tokenized by
+ * its own worker. Parts are handed out in file order, so rows are applied
+ * exactly as in a sequential read.
+ *
+ * Only jobs + 1 parts are in flight: a new part is started when one is
+ * handed out, so the rows held stay bounded however long the file is.
+ */
+
+#ifndef PARALLELREADER_H
+#define PARALLELREADER_H
+
+#include <cstring> // memchr
+#include <deque>
+#include <future>
+#include <utility> // move
+#include <vector>
+
+#include "CsvReader.h"
+
+using namespace std;
+
+class ParallelReader
+{
+public:
+    // Default length of the text of a part, a part ends at the first season
+    // boundary after it
+    static const size_t PART_BYTES = 256 * 1024;
+
+private:
+    // Parts started and not handed out yet, in file order
+    deque<future<vector<CsvRow> > > parts;
+
+    // Start of the next part to be started, and end of the text
+    const char *begin;
+    const char *end;
+
+    size_t part_length;
+    size_t window; // Parts in flight, at most
+
+    ParallelReader(const ParallelReader &);
+    ParallelReader &operator=(const ParallelReader &);
+
+    /**
+     * Returns the season field of the line starting at pos.
+     */
+    static FieldView season_at(const char *pos, const char *end)
+    {
+        const char *stop = static_cast<const char *>(memchr(pos, ',', end - pos));
+        return FieldView(pos, (stop == NULL ? end : stop) - pos);
+    }
+
+    /**
+     * Returns start of the line after the one containing pos.
+     */
+    static const char *next_line(const char *pos, const char *end)
+    {
+        const char *stop = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        return stop == NULL ? end : stop + 1;
+    }
+
+    /**
+     * Finds the first line at or after pos whose season differs from the
+     * line before it.
+     *
+     * @param begin {const char*} Start of the first row, a season starts here.
+     * @param pos {const char*} Any position after begin.
+     * @param end {const char*} End of the csv text.
+     */
+    static const char *season_start(const char *begin, const char *pos, const char *end)
+    {
+        if (pos <= begin)
+            return begin;
+
+        // Line containing pos - 1
+        const char *line = pos - 1;
+        while (line > begin && line[-1] != '\n')
+            line--;
+
+        FieldView season = season_at(line, end);
+        line = next_line(line, end);
+        while (line != end && season_at(line, end) == season)
+            line = next_line(line, end);
+        return line;
+    }
+
+    /**
+     * Tokenizes all rows of a part.
+     */
+    static vector<CsvRow> parse(const char *begin, const char *end)
+    {
+        vector<CsvRow> rows;
+        CsvReader reader(begin, end - begin);
+        CsvRow row;
+        while (reader.next(row))
+            rows.push_back(row);
+        return rows;
+    }
+
+    /**
+     * Starts a worker on the next part, if any is left.
+     */
+    void start_part()
+    {
+        if (begin == end)
+            return;
+
+        const char *stop = end;
+        if ((size_t)(end - begin) > part_length)
+            stop = season_start(begin, begin + part_length, end);
+        parts.push_back(async(launch::async, parse, begin, stop));
+        begin = stop;
+    }
+
+public:
+    /**
+     * Starts the workers on the first parts.
+     *
+     * @param data {const char*} Csv text without the header line.
+     * @param length {size_t} Length of the text.
+     * @param jobs {int} Number of worker threads.
+     * @param part_bytes {size_t} Length of the text of a part, about. Parts
+     * are shorter if the text does not fill jobs parts.
+     */
+    ParallelReader(const char *data, size_t length, int jobs, size_t part_bytes = PART_BYTES)
+        : begin(data), end(data + length), part_length(length / jobs + 1), window(jobs + 1)
+    {
+        if (part_length > part_bytes)
+            part_length = part_bytes;
+
+        for (size_t i = 0; i < window; i++)
+            start_part();
+    }
+
+    /**
+     * Waits for the next part and returns its rows. Starts another part in
+     * its place.
+     *
+     * @param rows {vector<CsvRow>} Filled with the rows of the part.
+     *
+     * @return {bool} False if all parts are returned.
+     */
+    bool next(vector<CsvRow> &rows)
+    {
+        if (parts.empty())
+            return false;
+
+        future<vector<CsvRow> > part = std::move(parts.front());
+        parts.pop_front();
+        start_part();
+
+        rows = part.get();
+        return true;
+    }
+};
+
+#endif
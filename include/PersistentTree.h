@@ -0,0 +1,511 @@
+/**
+ * PersistentTree class. Red-black tree which keeps frozen versions.
+ */
+
+#ifndef PERSISTENTTREE_H
+#define PERSISTENTTREE_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>  // shared_ptr
+#include <utility> // forward, pair
+#include <vector>
+
+#include "Node.h" // Color
+#include "NodePool.h"
+
+using namespace std;
+
+/**
+ * Node of PersistentTree. Has no parent pointer, so a node can be shared by
+ * several versions.
+ */
+template <class Data, class Key>
+struct PersistentNode
+{
+    PersistentNode *left, *right;
+    Color color;
+    unsigned int version; // Version which created the node, it is frozen if older than the current one
+    Key key;
+    Data data;
+
+    template <class K, class D>
+    PersistentNode(K &&key, D &&data, unsigned int version)
+        : left(NULL), right(NULL), color(RED), version(version), key(std::forward<K>(key)),
+          data(std::forward<D>(data))
+    {
+    }
+};
+
+/**
+ * Red-black tree keyed by Key whose state can be frozen as an immutable
+ * version, e.g. at the end of every season.
+ *
+ * Frozen nodes are never changed. An upsert copies the frozen nodes on the
+ * path from the root to its key, O(log n) of them, and changes the copies;
+ * the rest of the tree is shared with the frozen versions. Nodes created
+ * since the last freeze are changed in place, so a season costs one copy of
+ * every changed path, not one per row. Every version can be searched and
+ * visited while the current one is updated.
+ *
+ * The tree keeps its latest frozen versions, all of them unless
+ * keep_versions limits it. An older version lives while a Version handle
+ * refers to it or to an older version. A node copied by an upsert is freed
+ * once every version that may contain it is gone, which is checked at every
+ * freeze, so memory is bounded by the versions in use.
+ *
+ * Inserts rebalance like RedBlackTree, so the current version has the same
+ * shape as a RedBlackTree with the same inserts. Has the search/upsert/
+ * preorder contract of RedBlackTree. Keys are never removed, and an entry
+ * returned by upsert stays valid only until the next freeze.
+ */
+template <class Data, class Key>
+class PersistentTree
+{
+public:
+    typedef PersistentNode<Data, Key> Node;
+
+    // Type of the entries returned by search and upsert
+    typedef Node entry_type;
+
+private:
+    // Deeper than any red-black tree that fits in memory
+    static const int MAX_DEPTH = 128;
+
+    Node *root;
+    size_t node_count;
+
+    // Shared with the Version handles of a frozen version, so the version
+    // is in use while its count is more than one
+    struct Pin
+    {
+    };
+
+    struct Frozen
+    {
+        Node *root;
+        size_t node_count;
+        shared_ptr<const Pin> pin;
+
+        Frozen(Node *root, size_t node_count) : root(root), node_count(node_count), pin(make_shared<const Pin>())
+        {
+        }
+    };
+
+    // Frozen versions which are not dropped, oldest first, from index
+    // first_kept on
+    deque<Frozen> frozen;
+    size_t first_kept;
+
+    // Number of latest versions kept by the tree itself
+    size_t kept_versions;
+
+    // Nodes copied by upserts, by the version current at the copy, from
+    // index first_retired on. A node copied at version v belongs to no
+    // version from v on, so it is freed once every version before v is
+    // dropped.
+    deque<vector<Node *> > retired;
+    size_t first_retired;
+
+    NodePool<Node> pool;
+
+    PersistentTree(const PersistentTree &);
+    PersistentTree &operator=(const PersistentTree &);
+
+    /**
+     * Returns a node which can be changed: the node itself if it belongs to
+     * the current version, a copy of it otherwise.
+     */
+    Node *own(Node *node)
+    {
+        if (node->version == versions())
+            return node;
+
+        Node *copy = pool.create(*node);
+        copy->version = (unsigned int)versions();
+
+        // Nothing is dropped while all versions are kept
+        if (kept_versions != (size_t)-1)
+            retired.back().push_back(node);
+        return copy;
+    }
+
+    /**
+     * Drops the oldest versions which are neither kept nor in use, except
+     * the latest one, and frees the nodes no remaining version contains.
+     */
+    void reclaim()
+    {
+        // The last reference to a pin is dropped here, after every handle
+        // dropped its own, so their searches are over before nodes are freed
+        while (frozen.size() > 1 && frozen.size() > kept_versions && frozen.front().pin.use_count() == 1)
+        {
+            frozen.pop_front();
+            first_kept++;
+        }
+
+        for (; first_retired <= first_kept; first_retired++)
+        {
+            const vector<Node *> &nodes = retired.front();
+            for (size_t i = 0; i < nodes.size(); i++)
+                pool.destroy(nodes[i]);
+            retired.pop_front();
+        }
+    }
+
+    /**
+     * Links a subtree in place of another one, under the node at
+     * path[depth - 1] or as the root.
+     */
+    void replace_child(Node **path, int depth, Node *old_child, Node *new_child)
+    {
+        if (depth == 0)
+            root = new_child;
+        else if (path[depth - 1]->left == old_child)
+            path[depth - 1]->left = new_child;
+        else
+            path[depth - 1]->right = new_child;
+    }
+
+    /**
+     * Fixes red-black violations after an insert. path holds the nodes
+     * from the root to the new node, all of the current version.
+     */
+    void fix_insert(Node **path, int depth)
+    {
+        int i = depth - 1;
+        while (i >= 2 && path[i - 1]->color == RED)
+        {
+            Node *parent = path[i - 1];
+            Node *grandparent = path[i - 2];
+            bool left_parent = grandparent->left == parent;
+            Node *&uncle = left_parent ? grandparent->right : grandparent->left;
+
+            /* --- If uncle is RED --- */
+            if (uncle != NULL && uncle->color == RED)
+            {
+                // Recolor: parent, uncle, grandparent
+                uncle = own(uncle);
+                parent->color = BLACK;
+                uncle->color = BLACK;
+                grandparent->color = RED;
+                i -= 2;
+                continue;
+            }
+
+            /* --- If uncle is NULL or BLACK --- */
+            Node *ptr = path[i];
+            if (left_parent && parent->right == ptr)
+            {
+                // LeftRight, rotate left at parent
+                parent->right = ptr->left;
+                ptr->left = parent;
+                grandparent->left = ptr;
+                parent = ptr;
+            }
+            else if (!left_parent && parent->left == ptr)
+            {
+                // RightLeft, rotate right at parent
+                parent->left = ptr->right;
+                ptr->right = parent;
+                grandparent->right = ptr;
+                parent = ptr;
+            }
+
+            // LeftLeft or RightRight, rotate at grandparent
+            if (left_parent)
+            {
+                grandparent->left = parent->right;
+                parent->right = grandparent;
+            }
+            else
+            {
+                grandparent->right = parent->left;
+                parent->left = grandparent;
+            }
+            replace_child(path, i - 2, grandparent, parent);
+            parent->color = BLACK;
+            grandparent->color = RED;
+            break;
+        }
+
+        // Root is always BLACK
+        root->color = BLACK;
+    }
+
+    template <class NodePtr, class K>
+    static NodePtr search(NodePtr node, const K &key)
+    {
+        while (node != NULL)
+        {
+            if (node->key == key)
+                return node;
+            node = node->key < key ? node->right : node->left;
+        }
+        return NULL;
+    }
+
+    template <class Visitor>
+    static void preorder(const Node *node, int depth, Visitor &visit)
+    {
+        if (node == NULL)
+            return;
+
+        visit(node, depth);
+        preorder(node->left, depth + 1, visit);
+        preorder(node->right, depth + 1, visit);
+    }
+
+    template <class Visitor>
+    static void inorder(Node *node, Visitor &visit)
+    {
+        if (node == NULL)
+            return;
+
+        inorder(node->left, visit);
+        visit(node);
+        inorder(node->right, visit);
+    }
+
+public:
+    /**
+     * Handle of a frozen version: its root and size. Frozen nodes are never
+     * changed, so a handle can be searched from any thread while the tree
+     * is updated. The version and the older ones live while a handle refers
+     * to them, until the tree is cleared or destroyed.
+     */
+    class Version
+    {
+    private:
+        const Node *root;
+        size_t node_count;
+        shared_ptr<const Pin> pin;
+
+    public:
+        Version(const Node *root, size_t node_count, const shared_ptr<const Pin> &pin)
+            : root(root), node_count(node_count), pin(pin)
+        {
+        }
+
+        /**
+         * Search for a node. O(log n).
+         *
+         * @param key {K} Key to be used in comparison. Any type comparable with Key.
+         *
+         * @return {const Node*} NULL or node with the given key.
+         */
+        template <class K>
+        const Node *search(const K &key) const
+        {
+            return PersistentTree::search(root, key);
+        }
+
+        size_t size() const
+        {
+            return node_count;
+        }
+    };
+
+    PersistentTree()
+        : root(NULL), node_count(0), first_kept(0), kept_versions((size_t)-1), retired(1), first_retired(0)
+    {
+    }
+
+    /**
+     * Search for a node in the current version.
+     *
+     * @param key {K} Key to be used in comparison. Any type comparable with Key.
+     *
+     * @return {Node*} NULL or node with the given key. Changing it changes
+     * frozen versions too, use upsert to get a node that can be changed.
+     */
+    template <class K>
+    Node *search(const K &key) const
+    {
+        return search(root, key);
+    }
+
+    /**
+     * Search for a node in a frozen version. O(log n).
+     *
+     * @param key {K} Key to be used in comparison. Any type comparable with Key.
+     * @param version {size_t} Index of the version, at least first_version()
+     * and less than versions().
+     *
+     * @return {const Node*} NULL or node with the given key.
+     */
+    template <class K>
+    const Node *search(const K &key, size_t version) const
+    {
+        return search(frozen[version - first_kept].root, key);
+    }
+
+    /**
+     * Finds the node with the given key, inserts a new one if it does not
+     * exist. Frozen nodes on the path are copied, so the returned node can
+     * be changed until the next freeze without changing frozen versions.
+     *
+     * @param key {K} Key to be searched. Any type comparable with Key and
+     * convertible to it. The key of a new node is built from it in place.
+     * @param data {D} Data of the new node, moved if it is a temporary. Not
+     * used if key exists.
+     *
+     * @return {pair<Node*, bool>} Node with the given key and whether it is
+     * inserted by this call.
+     */
+    template <class K, class D>
+    pair<Node *, bool> upsert(const K &key, D &&data)
+    {
+        Node *path[MAX_DEPTH];
+        int depth = 0;
+
+        Node **link = &root;
+        while (*link != NULL)
+        {
+            Node *node = own(*link);
+            *link = node;
+            path[depth++] = node;
+
+            if (node->key == key)
+                return make_pair(node, false);
+            link = node->key < key ? &node->right : &node->left;
+        }
+
+        Node *node = pool.create(key, std::forward<D>(data), (unsigned int)versions());
+        *link = node;
+        path[depth++] = node;
+        node_count++;
+
+        fix_insert(path, depth);
+        return make_pair(node, true);
+    }
+
+    /**
+     * Freezes the current state as a new version; later changes copy the
+     * nodes they touch. Versions which are no longer kept or in use are
+     * dropped, O(1) plus the nodes freed.
+     *
+     * @return {size_t} Index of the frozen version.
+     */
+    size_t freeze()
+    {
+        frozen.push_back(Frozen(root, node_count));
+        retired.push_back(vector<Node *>());
+        reclaim();
+        return versions() - 1;
+    }
+
+    /**
+     * Sets how many of the latest versions the tree keeps. Older ones live
+     * only while a handle refers to them or to an older version, and are
+     * dropped at the next freeze otherwise. Should be set before the first
+     * freeze; nodes copied while all versions are kept are never freed.
+     *
+     * @param count {size_t} Number of versions, (size_t)-1 to keep all.
+     */
+    void keep_versions(size_t count)
+    {
+        kept_versions = count;
+    }
+
+    /**
+     * Returns a handle of a frozen version which does not refer to the tree
+     * itself, e.g. for reader threads. The handle keeps the version alive.
+     *
+     * @param version {size_t} Index of the version, at least
+     * first_version() and less than versions().
+     */
+    Version version(size_t version) const
+    {
+        const Frozen &state = frozen[version - first_kept];
+        return Version(state.root, state.node_count, state.pin);
+    }
+
+    /**
+     * Returns number of frozen versions, including the dropped ones.
+     */
+    size_t versions() const
+    {
+        return first_kept + frozen.size();
+    }
+
+    /**
+     * Returns index of the oldest version which is not dropped. Every
+     * version from it on can be searched.
+     */
+    size_t first_version() const
+    {
+        return first_kept;
+    }
+
+    /**
+     * Returns number of nodes in the current version.
+     */
+    size_t size() const
+    {
+        return node_count;
+    }
+
+    /**
+     * Returns number of nodes in a frozen version.
+     *
+     * @param version {size_t} Index of the version, at least
+     * first_version() and less than versions().
+     */
+    size_t size(size_t version) const
+    {
+        return frozen[version - first_kept].node_count;
+    }
+
+    /**
+     * Visits all nodes of the current version in preorder.
+     *
+     * @param visit {Visitor} Called as visit(const Node*, depth).
+     */
+    template <class Visitor>
+    void preorder(Visitor &visit) const
+    {
+        preorder(root, 0, visit);
+    }
+
+    /**
+     * Visits all nodes of a frozen version in preorder.
+     *
+     * @param visit {Visitor} Called as visit(const Node*, depth).
+     * @param version {size_t} Index of the version, at least
+     * first_version() and less than versions().
+     */
+    template <class Visitor>
+    void preorder(Visitor &visit, size_t version) const
+    {
+        preorder(frozen[version - first_kept].root, 0, visit);
+    }
+
+    /**
+     * Visits all nodes of the current version in sorted order.
+     *
+     * @param visit {Visitor} Called as visit(Node*).
+     */
+    template <class Visitor>
+    void inorder(Visitor &visit)
+    {
+        inorder(root, visit);
+    }
+
+    /**
+     * Removes all nodes and all versions. Handles of the versions must not
+     * be used after it.
+     */
+    void clear()
+    {
+        pool.release_all();
+        root = NULL;
+        node_count = 0;
+        frozen.clear();
+        first_kept = 0;
+        retired.assign(1, vector<Node *>());
+        first_retired = 0;
+    }
+};
+
+#endif
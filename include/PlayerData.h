@@ -7,38 +7,40 @@
 
 #include <iostream>
 
+#include "SeasonHistory.h"
+#include "SubtreeMax.h"
+
 using namespace std;
 
 struct PlayerData
 {
 public:
-    string team;
+    unsigned int team; // Interned team code
     int point;
     int total_point;
     int rebound;
     int total_rebound;
     int assist;
     int total_assist;
+    int last_season; // Index of the last season with a row of the player
+    SeasonHistory history; // Scores of every season, kept if requested
 
     PlayerData()
     {
     }
 
-    PlayerData(string team, int _point, int _rebound, int _assist)
+    PlayerData(unsigned int team, int _point, int _rebound, int _assist)
         : team(team), point(_point), total_point(_point), rebound(_rebound),
-          total_rebound(_rebound), assist(_assist), total_assist(_assist)
+          total_rebound(_rebound), assist(_assist), total_assist(_assist),
+          last_season(0)
     {
     }
 
-    PlayerData(const PlayerData &v)
+    friend std::ostream &
+    operator<<(std::ostream &os, const PlayerData &val)
     {
-        team = v.team;
-        point = v.point;
-        total_point = v.total_point;
-        rebound = v.rebound;
-        total_rebound = v.total_rebound;
-        assist = v.assist;
-        total_assist = v.total_assist;
+        os << val.point;
+        return os;
     }
 
     /**
@@ -59,4 +61,68 @@ public:
     }
 };
 
+/**
+ * Total scores of a player, in the order of SubtreeMax<PlayerData>::values.
+ */
+enum PlayerStat
+{
+    STAT_POINT,
+    STAT_ASSIST,
+    STAT_REBOUND,
+};
+
+/**
+ * Highest total point, assist and rebound in a subtree of players.
+ */
+template <>
+struct SubtreeMax<PlayerData>
+{
+    static const bool enabled = true;
+    static const int STAT_COUNT = 3;
+
+    int values[STAT_COUNT]; // Indexed by PlayerStat
+
+    /**
+     * Returns a total score of a player.
+     */
+    static int value(const PlayerData &data, int stat)
+    {
+        switch (stat)
+        {
+        case STAT_POINT:
+            return data.total_point;
+        case STAT_ASSIST:
+            return data.total_assist;
+        default:
+            return data.total_rebound;
+        }
+    }
+
+    void reset(const PlayerData &data)
+    {
+        values[STAT_POINT] = data.total_point;
+        values[STAT_ASSIST] = data.total_assist;
+        values[STAT_REBOUND] = data.total_rebound;
+    }
+
+    void add(const SubtreeMax &child)
+    {
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            if (child.values[i] > values[i])
+                values[i] = child.values[i];
+        }
+    }
+
+    bool operator==(const SubtreeMax &r) const
+    {
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            if (values[i] != r.values[i])
+                return false;
+        }
+        return true;
+    }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+/**
+ * Mappings between player names and tree keys.
+ *
+ * A mapping has a key_type, key(FieldView) giving the value used to look a
+ * name up in the tree and name(key_type) giving the name back for reports.
+ */
+
+#ifndef PLAYERKEYS_H
+#define PLAYERKEYS_H
+
+#include <string>
+
+#include "CsvReader.h"
+#include "StringInterner.h"
+
+using namespace std;
+
+/**
+ * Player names are used as tree keys.
+ */
+struct NameKeys
+{
+    typedef string key_type;
+
+    // Tree order is name order
+    static const bool ordered_by_name = true;
+
+    /**
+     * Names are looked up in the tree without copying them.
+     */
+    const FieldView &key(const FieldView &name)
+    {
+        return name;
+    }
+
+    const string &name(const string &key) const
+    {
+        return key;
+    }
+};
+
+/**
+ * Player names are interned, tree keys are their integer ids. Nodes are
+ * ordered by first appearance of the players instead of their names.
+ */
+struct InternedNameKeys
+{
+    typedef unsigned int key_type;
+
+    // Tree order is order of first appearance
+    static const bool ordered_by_name = false;
+
+    StringInterner names;
+
+    unsigned int key(const FieldView &name)
+    {
+        return names.intern(name.data, name.length);
+    }
+
+    const string &name(unsigned int key) const
+    {
+        return names.str(key);
+    }
+};
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * Read-only views of the players for reader threads.
+ *
+ * The loader updates its tree in place, so readers cannot use it while rows
+ * are added. Instead, a frozen version of a PersistentTree is published,
+ * at the end of every season and optionally every few rows. Frozen nodes
+ * are never modified, so any number of threads can search a view without
+ * locks, and they always see the players at a single point of the input.
+ * A view shares its nodes with the tree, so publishing one is O(1) and the
+ * loader only copies the paths it changes afterwards.
+ *
+ * Views are reference counted. Publishing a new view only replaces the
+ * pointer. A view keeps its version alive; once no view refers to a version
+ * or an older one, the tree drops it at its next freeze and frees the nodes
+ * copied from it. Nodes belong to the tree, so views can be used until the
+ * tree is cleared or destroyed.
+ */
+
+#ifndef READVIEW_H
+#define READVIEW_H
+
+#include <memory> // shared_ptr, atomic_load, atomic_store
+#include <string>
+
+#include "PersistentTree.h"
+#include "PlayerData.h"
+
+using namespace std;
+
+/**
+ * Players at the end of a season or at a row of it, keyed by name.
+ */
+class ReadView
+{
+public:
+    typedef PersistentTree<PlayerData, string> Tree;
+
+private:
+    int index;
+    string name;
+    Tree::Version players;
+
+    ReadView(const ReadView &);
+    ReadView &operator=(const ReadView &);
+
+public:
+    /**
+     * @param index {int} Index of the season.
+     * @param name {string} Name of the season.
+     * @param players {Tree::Version} Frozen version of the players.
+     */
+    ReadView(int index, const string &name, const Tree::Version &players)
+        : index(index), name(name), players(players)
+    {
+    }
+
+    int season_index() const
+    {
+        return index;
+    }
+
+    const string &season() const
+    {
+        return name;
+    }
+
+    size_t size() const
+    {
+        return players.size();
+    }
+
+    /**
+     * Finds a player.
+     *
+     * @param player {K} Name of the player, string or FieldView.
+     *
+     * @return {PlayerData*} NULL or totals of the player.
+     */
+    template <class K>
+    const PlayerData *search(const K &player) const
+    {
+        const Tree::Node *node = players.search(player);
+        return node != NULL ? &node->data : NULL;
+    }
+};
+
+/**
+ * Latest published view. Readers and the loader can use it at the same
+ * time; the pointer is swapped atomically.
+ */
+class ReadViewSlot
+{
+private:
+    shared_ptr<const ReadView> current;
+
+    ReadViewSlot(const ReadViewSlot &);
+    ReadViewSlot &operator=(const ReadViewSlot &);
+
+public:
+    ReadViewSlot()
+    {
+    }
+
+    /**
+     * Returns the latest view, NULL before the first season ends. The view
+     * stays valid while the returned pointer is held.
+     */
+    shared_ptr<const ReadView> acquire() const
+    {
+        return atomic_load(&current);
+    }
+
+    /**
+     * Replaces the latest view. Readers holding the old one are not
+     * affected.
+     */
+    void publish(const shared_ptr<const ReadView> &view)
+    {
+        atomic_store(&current, view);
+    }
+};
+
+#endif
@@ -5,13 +5,74 @@
 #ifndef REDBLACKTREE_H
 #define REDBLACKTREE_H
 
+#include <cstddef>  // ptrdiff_t
+#include <iterator> // bidirectional_iterator_tag
+#include <utility>  // forward, pair
+
 #include "Node.h"
+#include "NodePool.h"
+#include "TreeStats.h"
+
+using namespace std;
+
+/**
+ * Result of RedBlackTree::verify. Holds the first violation found and the
+ * shape of the tree.
+ */
+struct TreeCheck
+{
+    bool valid;
+    const char *error; // First violation, NULL if valid
+
+    unsigned int nodes;
+    int height;         // Nodes on the longest root to leaf path
+    int min_leaf_depth; // Nodes on the shortest root to leaf path
+    int black_height;   // Black nodes on every root to leaf path
+    unsigned long long depth_sum;
+
+    TreeCheck()
+        : valid(true), error(NULL), nodes(0), height(0), min_leaf_depth(-1), black_height(0),
+          depth_sum(0)
+    {
+    }
+
+    /**
+     * Records a violation. Returns -1, the error value of the checks.
+     */
+    int fail(const char *message)
+    {
+        if (valid)
+        {
+            valid = false;
+            error = message;
+        }
+        return -1;
+    }
+
+    /**
+     * Average number of nodes on the path from the root to a node.
+     */
+    double average_depth() const
+    {
+        return nodes != 0 ? (double)depth_sum / nodes : 0.0;
+    }
+};
 
-template <class Data, class Key>
+template <class Data, class Key, class Allocator = NodePool<Node<Data, Key> > >
 class RedBlackTree
 {
 private:
     Node<Data, Key> *root;
+    Allocator allocator;
+
+#ifdef RBT_STATS
+    // Changed by non-const members only, so const lookups from several
+    // threads do not race on the counters
+    TreeStats stats;
+#endif
+
+    RedBlackTree(const RedBlackTree &);
+    RedBlackTree &operator=(const RedBlackTree &);
 
     /**
      * Finds sibling of a node. Returns NULL if uncle does not exists.
@@ -32,20 +93,250 @@ private:
             return parent->left;
     }
 
+    /**
+     * Returns number of nodes in a subtree. Zero for NULL.
+     */
+    static unsigned int subtree_size(const Node<Data, Key> *ptr)
+    {
+        return ptr == NULL ? 0 : ptr->size;
+    }
+
+    /**
+     * Recomputes subtree size of a node from its children.
+     */
+    static void update_size(Node<Data, Key> *ptr)
+    {
+        ptr->size = 1 + subtree_size(ptr->left) + subtree_size(ptr->right);
+    }
+
+    /**
+     * Recomputes subtree maxima of a node from its data and its children.
+     */
+    static void update_max(Node<Data, Key> *ptr)
+    {
+        ptr->max().reset(ptr->data);
+        if (ptr->left != NULL)
+            ptr->max().add(ptr->left->max());
+        if (ptr->right != NULL)
+            ptr->max().add(ptr->right->max());
+    }
+
+    /**
+     * Increments subtree sizes and raises subtree maxima of the ancestors of
+     * a newly linked node.
+     */
+    static void grow_path(Node<Data, Key> *ptr)
+    {
+        for (Node<Data, Key> *up = ptr->parent; up != NULL; up = up->parent)
+        {
+            up->size++;
+            up->max().add(ptr->max());
+        }
+    }
+
+    /**
+     * Returns height of a subtree. Zero for NULL. Recursive
+     */
+    static int subtree_height(const Node<Data, Key> *ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        int left = subtree_height(ptr->left);
+        int right = subtree_height(ptr->right);
+        return 1 + (left > right ? left : right);
+    }
+
+    /**
+     * Checks a subtree against the red-black and BST rules. Recursive
+     *
+     * @param ptr {Node*} Root of the subtree.
+     * @param parent {Node*} Expected parent of ptr.
+     * @param low {Node*} Keys must be greater than its key. NULL for no bound.
+     * @param high {Node*} Keys must be less than its key. NULL for no bound.
+     * @param depth {int} Number of nodes above ptr.
+     * @param check {TreeCheck} Collects the violation and the statistics.
+     *
+     * @return {int} Black height of the subtree, -1 if a rule is broken.
+     */
+    static int check_subtree(const Node<Data, Key> *ptr, const Node<Data, Key> *parent,
+                             const Node<Data, Key> *low, const Node<Data, Key> *high, int depth,
+                             TreeCheck &check)
+    {
+        if (ptr == NULL)
+        {
+            if (check.min_leaf_depth < 0 || depth < check.min_leaf_depth)
+                check.min_leaf_depth = depth;
+            return 0;
+        }
+
+        if (ptr->parent != parent)
+            return check.fail("parent link does not match");
+        if ((low != NULL && !(low->key < ptr->key)) || (high != NULL && !(ptr->key < high->key)))
+            return check.fail("keys are not in BST order");
+        if (ptr->color == RED && parent != NULL && parent->color == RED)
+            return check.fail("red node has a red child");
+
+        check.nodes++;
+        check.depth_sum += depth + 1;
+        if (depth + 1 > check.height)
+            check.height = depth + 1;
+
+        int left = check_subtree(ptr->left, ptr, low, ptr, depth + 1, check);
+        if (left < 0)
+            return -1;
+        int right = check_subtree(ptr->right, ptr, ptr, high, depth + 1, check);
+        if (right < 0)
+            return -1;
+
+        if (left != right)
+            return check.fail("black heights of children differ");
+        if (ptr->size != 1 + subtree_size(ptr->left) + subtree_size(ptr->right))
+            return check.fail("subtree size is wrong");
+
+        SubtreeMax<Data> max;
+        max.reset(ptr->data);
+        if (ptr->left != NULL)
+            max.add(ptr->left->max());
+        if (ptr->right != NULL)
+            max.add(ptr->right->max());
+        if (!(ptr->max() == max))
+            return check.fail("subtree maximum is wrong");
+
+        return left + (ptr->color == BLACK ? 1 : 0);
+    }
+
+    /**
+     * Finds the first node in key order with the largest value of a stat
+     * among the keys of a subtree in [low, high]. Subtrees inside the range
+     * are only compared by their maxima, so O(log n) nodes are visited.
+     *
+     * @param ptr {Node*} Root of the subtree.
+     * @param low_bounded {bool} Whether the subtree has keys below low.
+     * @param high_bounded {bool} Whether the subtree has keys above high.
+     * @param best {Node*} Best node or subtree so far, NULL if none.
+     * @param best_whole {bool} Whether best is a whole subtree.
+     */
+    template <class K>
+    static void range_max(Node<Data, Key> *ptr, const K &low, const K &high, bool low_bounded,
+                          bool high_bounded, int stat, Node<Data, Key> *&best, bool &best_whole)
+    {
+        if (ptr == NULL)
+            return;
+
+        if (!low_bounded && !high_bounded)
+        {
+            if (best == NULL || ptr->max().values[stat] > best_value(best, best_whole, stat))
+            {
+                best = ptr;
+                best_whole = true;
+            }
+            return;
+        }
+
+        if (low_bounded && ptr->key < low)
+        {
+            range_max(ptr->right, low, high, low_bounded, high_bounded, stat, best, best_whole);
+            return;
+        }
+        if (high_bounded && !(ptr->key < high || ptr->key == high))
+        {
+            range_max(ptr->left, low, high, low_bounded, high_bounded, stat, best, best_whole);
+            return;
+        }
+
+        // Key is in the range, visit left subtree, node and right subtree in order
+        range_max(ptr->left, low, high, low_bounded, false, stat, best, best_whole);
+        if (best == NULL || SubtreeMax<Data>::value(ptr->data, stat) > best_value(best, best_whole, stat))
+        {
+            best = ptr;
+            best_whole = false;
+        }
+        range_max(ptr->right, low, high, false, high_bounded, stat, best, best_whole);
+    }
+
+    static int best_value(const Node<Data, Key> *best, bool best_whole, int stat)
+    {
+        return best_whole ? best->max().values[stat] : SubtreeMax<Data>::value(best->data, stat);
+    }
+
+    /**
+     * Returns the node with the smallest key in a subtree.
+     */
+    static Node<Data, Key> *minimum(Node<Data, Key> *ptr)
+    {
+        while (ptr != NULL && ptr->left != NULL)
+            ptr = ptr->left;
+        return ptr;
+    }
+
+    /**
+     * Returns the node with the largest key in a subtree.
+     */
+    static Node<Data, Key> *maximum(Node<Data, Key> *ptr)
+    {
+        while (ptr != NULL && ptr->right != NULL)
+            ptr = ptr->right;
+        return ptr;
+    }
+
+    /**
+     * Returns the next node in sorted order. NULL after the last node.
+     */
+    static Node<Data, Key> *successor(Node<Data, Key> *ptr)
+    {
+        if (ptr->right != NULL)
+            return minimum(ptr->right);
+
+        Node<Data, Key> *parent = ptr->parent;
+        while (parent != NULL && parent->right == ptr)
+        {
+            ptr = parent;
+            parent = parent->parent;
+        }
+        return parent;
+    }
+
+    /**
+     * Returns the previous node in sorted order. NULL before the first node.
+     */
+    static Node<Data, Key> *predecessor(Node<Data, Key> *ptr)
+    {
+        if (ptr->left != NULL)
+            return maximum(ptr->left);
+
+        Node<Data, Key> *parent = ptr->parent;
+        while (parent != NULL && parent->left == ptr)
+        {
+            ptr = parent;
+            parent = parent->parent;
+        }
+        return parent;
+    }
+
     /**
      * BST search on a subtree. Recursive
      * 
      * @param root {Node*} Root of the subtree.
-     * @param key {Key} Key attrubute to check on nodes.
+     * @param key {K} Key attrubute to check on nodes. Any type comparable
+     * with Key.
      * 
      * @return {Node*} NULL or node with the given key.
      */
-    static Node<Data, Key> *BSTsearch(Node<Data, Key> *&root, Key key)
+    template <class K>
+    Node<Data, Key> *BSTsearch(Node<Data, Key> *root, const K &key)
     {
-        if (root == NULL || root->key == key)
+        if (root == NULL)
+        {
+            return root;
+        }
+        RBT_STAT(stats.search_steps++);
+        RBT_STAT(stats.comparisons++);
+        if (root->key == key)
         {
             return root;
         }
+        RBT_STAT(stats.comparisons++);
         if (root->key < key)
         {
             return BSTsearch(root->right, key);
@@ -56,21 +347,40 @@ private:
         }
     }
 
+    /**
+     * BST search on a subtree without counters, for const lookups.
+     *
+     * @param root {Node*} Root of the subtree.
+     * @param key {K} Key attrubute to check on nodes. Any type comparable
+     * with Key.
+     *
+     * @return {Node*} NULL or node with the given key.
+     */
+    template <class K>
+    static Node<Data, Key> *BSTfind(Node<Data, Key> *root, const K &key)
+    {
+        while (root != NULL && !(root->key == key))
+            root = root->key < key ? root->right : root->left;
+        return root;
+    }
+
     /**
      * BST insert operation on a subtree. Recursive
      * 
      * @param root {Node*} Root of the subtree.
      * @param ptr {Node*} Pointer to the Node to be inserted.
      */
-    static void BSTinsert(Node<Data, Key> *&root, Node<Data, Key> *&ptr)
+    void BSTinsert(Node<Data, Key> *&root, Node<Data, Key> *&ptr)
     {
         // Edge case, first node is root
         if (root == NULL)
         {
             root = ptr;
+            return;
         }
 
-        else if (root->key < ptr->key)
+        RBT_STAT(stats.comparisons++);
+        if (root->key < ptr->key)
         {
             if (root->right == NULL)
             {
@@ -103,6 +413,7 @@ private:
      */
     void rotate_left(Node<Data, Key> *&ptr)
     {
+        RBT_STAT(stats.rotations++);
         Node<Data, Key> *parent = ptr->parent;
         Node<Data, Key> *rchild = ptr->right;
 
@@ -120,6 +431,12 @@ private:
         ptr->parent = rchild;
         rchild->parent = parent;
 
+        // New subtree root takes the old size, ptr lost rchild's right subtree
+        rchild->size = ptr->size;
+        update_size(ptr);
+        update_max(ptr);
+        update_max(rchild);
+
         if (root->key == ptr->key)
         {
             root = rchild;
@@ -133,6 +450,7 @@ private:
      */
     void rotate_right(Node<Data, Key> *&ptr)
     {
+        RBT_STAT(stats.rotations++);
         Node<Data, Key> *lchild = ptr->left;
         Node<Data, Key> *parent = ptr->parent;
 
@@ -151,6 +469,12 @@ private:
         ptr->parent = lchild;
         lchild->parent = parent;
 
+        // New subtree root takes the old size, ptr lost lchild's left subtree
+        lchild->size = ptr->size;
+        update_size(ptr);
+        update_max(ptr);
+        update_max(lchild);
+
         if (root->key == ptr->key)
         {
             root = lchild;
@@ -224,6 +548,7 @@ private:
                 rotate_right(grandparent);
                 grandparent->toggle_color();
                 parent->toggle_color();
+                RBT_STAT(stats.recolorings += 2);
                 break;
             case 1:
                 // LeftRight
@@ -240,6 +565,7 @@ private:
                 rotate_left(grandparent);
                 grandparent->toggle_color();
                 parent->toggle_color();
+                RBT_STAT(stats.recolorings += 2);
                 break;
             default:
                 // No grandparent or parent exists
@@ -256,32 +582,266 @@ private:
             ptr->parent->toggle_color();
             uncle->toggle_color();
             gparent->toggle_color();
+            RBT_STAT(stats.recolorings += 3);
 
             // Recursive call on grandparent
             fix_insert(gparent);
         }
 
         // Root is always BLACK
+        RBT_STAT(if (root->color == RED) stats.recolorings++);
         root->color = BLACK;
     }
 
-    static void BSTpreorder_print(Node<Data, Key> *root, int depth)
+    /**
+     * Replaces a subtree with another one in the parent of the first.
+     * 
+     * @param u {Node*} Root of the subtree to be replaced.
+     * @param v {Node*} Root of the new subtree. May be NULL.
+     */
+    void transplant(Node<Data, Key> *u, Node<Data, Key> *v)
+    {
+        if (u->parent == NULL)
+            root = v;
+        else if (u->parent->left == u)
+            u->parent->left = v;
+        else
+            u->parent->right = v;
+
+        if (v != NULL)
+            v->parent = u->parent;
+    }
+
+    /**
+     * Returns whether a node is black. NULL leaves are black.
+     */
+    static bool is_black(const Node<Data, Key> *ptr)
+    {
+        return ptr == NULL || ptr->color == BLACK;
+    }
+
+    /**
+     * Maintains red-black property after removal of a black node.
+     * 
+     * @param ptr {Node*} Node which took place of the removed one. Carries an
+     * extra black. May be NULL.
+     * @param parent {Node*} Parent of ptr.
+     */
+    void fix_erase(Node<Data, Key> *ptr, Node<Data, Key> *parent)
+    {
+        while (ptr != root && is_black(ptr))
+        {
+            if (parent->left == ptr)
+            {
+                Node<Data, Key> *sibling = parent->right;
+
+                // Red sibling, rotate to get a black one
+                if (sibling->color == RED)
+                {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotate_left(parent);
+                    sibling = parent->right;
+                }
+
+                if (is_black(sibling->left) && is_black(sibling->right))
+                {
+                    // Move extra black up
+                    sibling->color = RED;
+                    ptr = parent;
+                    parent = ptr->parent;
+                }
+                else
+                {
+                    // Make far child of sibling red
+                    if (is_black(sibling->right))
+                    {
+                        sibling->left->color = BLACK;
+                        sibling->color = RED;
+                        rotate_right(sibling);
+                        sibling = parent->right;
+                    }
+
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->right->color = BLACK;
+                    rotate_left(parent);
+                    ptr = root;
+                }
+            }
+            else
+            {
+                Node<Data, Key> *sibling = parent->left;
+
+                // Red sibling, rotate to get a black one
+                if (sibling->color == RED)
+                {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rotate_right(parent);
+                    sibling = parent->left;
+                }
+
+                if (is_black(sibling->left) && is_black(sibling->right))
+                {
+                    // Move extra black up
+                    sibling->color = RED;
+                    ptr = parent;
+                    parent = ptr->parent;
+                }
+                else
+                {
+                    // Make far child of sibling red
+                    if (is_black(sibling->left))
+                    {
+                        sibling->right->color = BLACK;
+                        sibling->color = RED;
+                        rotate_left(sibling);
+                        sibling = parent->left;
+                    }
+
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    sibling->left->color = BLACK;
+                    rotate_right(parent);
+                    ptr = root;
+                }
+            }
+        }
+
+        if (ptr != NULL)
+            ptr->color = BLACK;
+    }
+
+    /**
+     * Builds a balanced subtree from a sorted range. Recursive
+     * 
+     * Middle element becomes the root, so leaves differ in depth by at most
+     * one. Nodes on the last, incomplete level are red, others are black.
+     * 
+     * @param first {Iterator} Start of the range of (key, data) pairs.
+     * @param count {size_t} Number of elements in the range.
+     * @param depth {int} Depth of the subtree root.
+     * @param red_depth {int} Depth of the incomplete level.
+     * @param parent {Node*} Parent of the subtree root.
+     * 
+     * @return {Node*} Root of the subtree.
+     */
+    template <class Iterator>
+    Node<Data, Key> *build_subtree(Iterator first, size_t count, int depth, int red_depth,
+                                   Node<Data, Key> *parent)
+    {
+        if (count == 0)
+            return NULL;
+
+        size_t middle = count / 2;
+        Iterator it = first + middle;
+
+        Node<Data, Key> *node = create_node(it->second, it->first);
+        node->color = (depth == red_depth) ? RED : BLACK;
+        node->parent = parent;
+        node->size = count;
+        node->left = build_subtree(first, middle, depth + 1, red_depth, node);
+        node->right = build_subtree(it + 1, count - middle - 1, depth + 1, red_depth, node);
+        update_max(node);
+        return node;
+    }
+
+    /**
+     * Visits nodes of a subtree in preorder. Recursive
+     * 
+     * @param root {Node*} Root of the subtree.
+     * @param depth {int} Depth of the root.
+     * @param visit {Visitor} Called as visit(node, depth).
+     */
+    template <class Visitor>
+    static void BSTpreorder(Node<Data, Key> *root, int depth, Visitor &visit)
     {
         if (root == NULL)
             return;
 
-        for (int i = 0; i < depth; i++)
-            cout << "-";
+        visit(root, depth);
+        BSTpreorder(root->left, depth + 1, visit);
+        BSTpreorder(root->right, depth + 1, visit);
+    }
 
-        if (root->color == BLACK)
-            cout << "(BLACK) ";
-        else
-            cout << "(RED) ";
+public:
+    // Type of the entries returned by search and upsert
+    typedef Node<Data, Key> entry_type;
 
-        cout << root->key << endl;
-        BSTpreorder_print(root->left, depth + 1);
-        BSTpreorder_print(root->right, depth + 1);
-    }
+    /**
+     * Bidirectional iterator over the nodes in sorted order. Follows parent
+     * links, so it needs no stack. Decrementing end() gives the last node.
+     */
+    class iterator
+    {
+    private:
+        friend class RedBlackTree;
+
+        const RedBlackTree *tree;
+        Node<Data, Key> *ptr;
+
+        iterator(const RedBlackTree *tree, Node<Data, Key> *ptr) : tree(tree), ptr(ptr)
+        {
+        }
+
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Node<Data, Key> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Node<Data, Key> *pointer;
+        typedef Node<Data, Key> &reference;
+
+        iterator() : tree(NULL), ptr(NULL)
+        {
+        }
+
+        reference operator*() const
+        {
+            return *ptr;
+        }
+
+        pointer operator->() const
+        {
+            return ptr;
+        }
+
+        iterator &operator++()
+        {
+            ptr = successor(ptr);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        iterator &operator--()
+        {
+            ptr = (ptr == NULL) ? maximum(tree->root) : predecessor(ptr);
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const iterator &r) const
+        {
+            return ptr == r.ptr;
+        }
+
+        bool operator!=(const iterator &r) const
+        {
+            return ptr != r.ptr;
+        }
+    };
 
 public:
     /**
@@ -297,7 +857,68 @@ public:
      */
     ~RedBlackTree()
     {
-        delete_subtree(root);
+        clear();
+    }
+
+    /**
+     * Deallocates all nodes of the tree. Pooled nodes are freed in one step.
+     */
+    void clear()
+    {
+        if (!allocator.release_all())
+            delete_subtree(root);
+        root = NULL;
+    }
+
+    /**
+     * Creates a node using the allocator of the tree. Nodes to be inserted
+     * should be created with this method.
+     * 
+     * @param node_data {D} Data of the node, moved if it is a temporary.
+     * @param node_key {K} Key of the node, or a value Key is built from.
+     * 
+     * @return {Node*} Pointer to the new node.
+     */
+    template <class D, class K>
+    Node<Data, Key> *create_node(D &&node_data, K &&node_key)
+    {
+        return allocator.create(std::forward<D>(node_data), std::forward<K>(node_key));
+    }
+
+    /**
+     * Builds the tree from a sorted range of (key, data) pairs.
+     * 
+     * @param first {Iterator} Start of the range, random access.
+     * @param last {Iterator} End of the range.
+     */
+    template <class Iterator>
+    RedBlackTree(Iterator first, Iterator last)
+    {
+        root = NULL;
+        build_sorted(first, last);
+    }
+
+    /**
+     * Replaces the contents of the tree with a sorted range of (key, data)
+     * pairs. O(n), no comparisons or rotations are made.
+     * 
+     * @param first {Iterator} Start of the range, random access. Keys must
+     * be strictly increasing.
+     * @param last {Iterator} End of the range.
+     */
+    template <class Iterator>
+    void build_sorted(Iterator first, Iterator last)
+    {
+        clear();
+
+        size_t count = last - first;
+
+        // Number of complete levels of a tree with count nodes
+        int full_levels = 0;
+        while (((size_t)1 << (full_levels + 1)) - 1 <= count)
+            full_levels++;
+
+        root = build_subtree(first, count, 0, full_levels, (Node<Data, Key> *)NULL);
     }
 
     /**
@@ -314,17 +935,35 @@ public:
 
         delete_subtree(ptr->left);
         delete_subtree(ptr->right);
-        delete ptr;
+        allocator.destroy(ptr);
     }
 
     /**
      * Search for a node in the tree.
      * 
-     * @param key {Key} Key to be used in comparison.
+     * @param key {K} Key to be used in comparison. Any type comparable with
+     * Key.
+     */
+    template <class K>
+    Node<Data, Key> *search(const K &key)
+    {
+        RBT_STAT(unsigned long long first_step = stats.search_steps);
+        Node<Data, Key> *node = BSTsearch(root, key);
+        RBT_STAT(stats.end_search(first_step));
+        return node;
+    }
+
+    /**
+     * Search for a node in a tree which is not modified, e.g. from several
+     * reader threads. Not counted in the statistics.
+     *
+     * @param key {K} Key to be used in comparison. Any type comparable with
+     * Key.
      */
-    Node<Data, Key> *search(Key key)
+    template <class K>
+    const Node<Data, Key> *search(const K &key) const
     {
-        return BSTsearch(root, key);
+        return BSTfind(root, key);
     }
 
     /**
@@ -332,12 +971,14 @@ public:
      * 
      * Rearranges colors and positions of nodes if needed.
      * 
-     * @param node {Node*} Pointer to the node to be inserted.
+     * @param node {Node*} Pointer to the node to be inserted. Should be
+     * created by create_node.
      */
     void insert(Node<Data, Key> *node)
     {
         // BST Insertion, initial color is red
         BSTinsert(root, node);
+        grow_path(node);
 
         if (root->key == node->key)
         {
@@ -348,9 +989,407 @@ public:
         fix_insert(node);
     }
 
-    void preorder_print()
+    /**
+     * Finds the node with the given key, inserts a new one if it does not
+     * exist. Uses a single descent from the root.
+     * 
+     * @param key {K} Key to be searched. Any type comparable with Key and
+     * convertible to it, so a lookup that hits does not build a Key. The
+     * key of a new node is built from it in place.
+     * @param data {D} Data of the new node, moved if it is a temporary. Not
+     * used if key exists.
+     * 
+     * @return {pair<Node*, bool>} Node with the given key and whether it is
+     * inserted by this call.
+     */
+    template <class K, class D>
+    pair<Node<Data, Key> *, bool> upsert(const K &key, D &&data)
+    {
+        Node<Data, Key> *parent = NULL;
+        Node<Data, Key> *ptr = root;
+        bool go_right = false;
+        RBT_STAT(unsigned long long first_step = stats.search_steps);
+
+        while (ptr != NULL)
+        {
+            RBT_STAT(stats.search_steps++);
+            RBT_STAT(stats.comparisons += 2);
+            if (ptr->key == key)
+            {
+                RBT_STAT(stats.comparisons--);
+                RBT_STAT(stats.end_search(first_step));
+                return make_pair(ptr, false);
+            }
+            parent = ptr;
+            go_right = ptr->key < key;
+            ptr = go_right ? ptr->right : ptr->left;
+        }
+        RBT_STAT(stats.end_search(first_step));
+
+        // Key does not exist, link a new node to the last visited node
+        Node<Data, Key> *node = create_node(std::forward<D>(data), key);
+        node->parent = parent;
+        if (parent == NULL)
+            root = node;
+        else if (go_right)
+            parent->right = node;
+        else
+            parent->left = node;
+        grow_path(node);
+
+        if (root == node)
+        {
+            node->color = BLACK;
+        }
+
+        // Fix any insert violation
+        fix_insert(node);
+        return make_pair(node, true);
+    }
+
+    /**
+     * Returns iterator to the node with the smallest key.
+     */
+    iterator begin() const
+    {
+        return iterator(this, minimum(root));
+    }
+
+    /**
+     * Returns iterator past the node with the largest key.
+     */
+    iterator end() const
+    {
+        return iterator(this, NULL);
+    }
+
+    /**
+     * Returns iterator to the first node whose key is not less than the
+     * given key. O(log n)
+     * 
+     * @param key {K} Key to be searched. Any type comparable with Key.
+     */
+    template <class K>
+    iterator lower_bound(const K &key) const
+    {
+        Node<Data, Key> *ptr = root;
+        Node<Data, Key> *result = NULL;
+
+        while (ptr != NULL)
+        {
+            if (ptr->key < key)
+            {
+                ptr = ptr->right;
+            }
+            else
+            {
+                result = ptr;
+                ptr = ptr->left;
+            }
+        }
+        return iterator(this, result);
+    }
+
+    /**
+     * Returns iterator to the first node whose key is greater than the
+     * given key. O(log n)
+     * 
+     * @param key {K} Key to be searched. Any type comparable with Key.
+     */
+    template <class K>
+    iterator upper_bound(const K &key) const
+    {
+        Node<Data, Key> *ptr = root;
+        Node<Data, Key> *result = NULL;
+
+        while (ptr != NULL)
+        {
+            if (ptr->key < key || ptr->key == key)
+            {
+                ptr = ptr->right;
+            }
+            else
+            {
+                result = ptr;
+                ptr = ptr->left;
+            }
+        }
+        return iterator(this, result);
+    }
+
+    /**
+     * Returns range of nodes with the given key. Empty or a single node,
+     * since keys are unique.
+     * 
+     * @param key {K} Key to be searched. Any type comparable with Key.
+     */
+    template <class K>
+    pair<iterator, iterator> equal_range(const K &key) const
+    {
+        return make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    /**
+     * Removes a node from the tree and deallocates it.
+     * 
+     * Other nodes are relinked, not copied, so pointers to them stay valid.
+     * 
+     * @param node {Node*} Node of this tree.
+     */
+    void erase(Node<Data, Key> *node)
+    {
+        Node<Data, Key> *removed = node; // Node leaving its position
+        Color removed_color = removed->color;
+        Node<Data, Key> *child;
+        Node<Data, Key> *child_parent;
+
+        if (node->left == NULL)
+        {
+            child = node->right;
+            child_parent = node->parent;
+            transplant(node, node->right);
+        }
+        else if (node->right == NULL)
+        {
+            child = node->left;
+            child_parent = node->parent;
+            transplant(node, node->left);
+        }
+        else
+        {
+            // Successor takes place of the node
+            removed = minimum(node->right);
+            removed_color = removed->color;
+            child = removed->right;
+
+            if (removed->parent == node)
+            {
+                child_parent = removed;
+            }
+            else
+            {
+                child_parent = removed->parent;
+                transplant(removed, removed->right);
+                removed->right = node->right;
+                removed->right->parent = removed;
+            }
+
+            transplant(node, removed);
+            removed->left = node->left;
+            removed->left->parent = removed;
+            removed->color = node->color;
+        }
+
+        // Subtree sizes and maxima changed only on the path above the removal
+        for (Node<Data, Key> *ptr = child_parent; ptr != NULL; ptr = ptr->parent)
+        {
+            update_size(ptr);
+            update_max(ptr);
+        }
+
+        if (removed_color == BLACK)
+            fix_erase(child, child_parent);
+
+        allocator.destroy(node);
+    }
+
+    /**
+     * Removes the node with the given key.
+     * 
+     * @param key {K} Key to be removed. Any type comparable with Key.
+     * 
+     * @return {bool} False if the key is not in the tree.
+     */
+    template <class K>
+    bool erase(const K &key)
+    {
+        Node<Data, Key> *node = BSTsearch(root, key);
+        if (node == NULL)
+            return false;
+
+        erase(node);
+        return true;
+    }
+
+    /**
+     * Returns number of nodes in the tree.
+     */
+    unsigned int size() const
+    {
+        return subtree_size(root);
+    }
+
+    /**
+     * Returns number of nodes on the longest path from the root to a leaf.
+     * Zero for an empty tree. O(n)
+     */
+    int height() const
+    {
+        return subtree_height(root);
+    }
+
+    /**
+     * Checks all rules of the tree: black root, no red node with a red
+     * child, the same black height on every path, BST order, parent links,
+     * subtree sizes and subtree maxima. O(n)
+     *
+     * @return {TreeCheck} First violation, if any, and height and balance
+     * statistics.
+     */
+    TreeCheck verify() const
+    {
+        TreeCheck check;
+        if (root != NULL && root->color != BLACK)
+            check.fail("root is red");
+        else
+            check.black_height = check_subtree(root, NULL, NULL, NULL, 0, check);
+        return check;
+    }
+
+#ifdef RBT_STATS
+    /**
+     * Returns the operation counters since the last reset.
+     */
+    const TreeStats &statistics() const
+    {
+        return stats;
+    }
+
+    void reset_statistics()
+    {
+        stats.reset();
+    }
+#endif
+
+    /**
+     * Returns number of keys smaller than the given key, i.e. zero based
+     * position of the key in sorted order. O(log n)
+     * 
+     * @param key {K} Key to be ranked. Does not have to be in the tree.
+     */
+    template <class K>
+    unsigned int rank(const K &key) const
+    {
+        unsigned int result = 0;
+        const Node<Data, Key> *ptr = root;
+
+        while (ptr != NULL)
+        {
+            if (ptr->key < key)
+            {
+                result += subtree_size(ptr->left) + 1;
+                ptr = ptr->right;
+            }
+            else
+            {
+                ptr = ptr->left;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Finds the node at a position in sorted order. O(log n)
+     * 
+     * @param index {unsigned int} Zero based position.
+     * 
+     * @return {Node*} Node at the position, NULL if index >= size().
+     */
+    Node<Data, Key> *select(unsigned int index) const
+    {
+        Node<Data, Key> *ptr = root;
+
+        while (ptr != NULL)
+        {
+            unsigned int left_size = subtree_size(ptr->left);
+            if (index < left_size)
+            {
+                ptr = ptr->left;
+            }
+            else if (index == left_size)
+            {
+                return ptr;
+            }
+            else
+            {
+                index -= left_size + 1;
+                ptr = ptr->right;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * Recomputes subtree maxima after the data of a node is changed.
+     * Ancestors are visited until their maxima stay the same. O(log n)
+     *
+     * @param node {Node*} Node of this tree whose data is changed.
+     */
+    void refresh(Node<Data, Key> *node)
+    {
+        for (; node != NULL; node = node->parent)
+        {
+            SubtreeMax<Data> old_max = node->max();
+            update_max(node);
+            if (node->max() == old_max)
+                break;
+        }
+    }
+
+    /**
+     * Finds the node with the largest value of a stat among the keys in
+     * [low, high]. The first one in key order is returned for ties.
+     * Needs a data type with SubtreeMax. O(log n)
+     *
+     * @param low {K} Smallest key of the range. Any type comparable with Key.
+     * @param high {K} Largest key of the range.
+     * @param stat {int} Index of the value in SubtreeMax<Data>::values.
+     *
+     * @return {Node*} NULL if no key is in the range.
+     */
+    template <class K>
+    Node<Data, Key> *range_max(const K &low, const K &high, int stat) const
+    {
+        Node<Data, Key> *best = NULL;
+        bool best_whole = false;
+        range_max(root, low, high, true, true, stat, best, best_whole);
+        if (best == NULL || !best_whole)
+            return best;
+
+        // Maximum is inside a whole subtree, follow the maxima to it
+        int target = best->max().values[stat];
+        for (;;)
+        {
+            if (best->left != NULL && best->left->max().values[stat] == target)
+                best = best->left;
+            else if (SubtreeMax<Data>::value(best->data, stat) == target)
+                return best;
+            else
+                best = best->right;
+        }
+    }
+
+    /**
+     * Visits all nodes in preorder.
+     * 
+     * @param visit {Visitor} Called as visit(node, depth).
+     */
+    template <class Visitor>
+    void preorder(Visitor &visit)
+    {
+        BSTpreorder(root, 0, visit);
+    }
+
+    /**
+     * Visits all nodes in sorted order.
+     *
+     * @param visit {Visitor} Called as visit(node).
+     */
+    template <class Visitor>
+    void inorder(Visitor &visit)
     {
-        BSTpreorder_print(root, 0);
+        for (iterator it = begin(); it != end(); ++it)
+            visit(&*it);
     }
 };
 
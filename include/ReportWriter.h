@@ -0,0 +1,152 @@
+/**
+ * ReportWriter class. Formats and writes season reports on its own thread.
+ */
+
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include <atomic>
+#include <cstdio> // FILE
+#include <thread>
+#include <vector>
+
+#include "OutputBuffer.h"
+#include "SpscQueue.h"
+#include "TreeDump.h"
+
+using namespace std;
+
+/**
+ * Last stage of a pipelined run. The tree thread hands over report text
+ * through an OutputBuffer on this sink and tree dumps as recorded entries;
+ * a writer thread formats the dumps and writes everything to the file in
+ * the order it is handed over. The tree thread only waits when the queue is
+ * full.
+ */
+class ReportWriter : public OutputSink
+{
+private:
+    /**
+     * Text chunk or recorded dump, in output order.
+     */
+    struct Item
+    {
+        vector<char> text;
+        vector<DumpEntry> dump;
+        DumpMode mode;
+        bool last; // Ends the output
+
+        Item() : mode(DUMP_OFF), last(false)
+        {
+        }
+    };
+
+    FILE *file;
+    SpscQueue<Item> queue;
+
+    // Items handed over by the tree thread, and written by the writer thread
+    size_t pushed;
+    atomic<size_t> written;
+
+    thread worker;
+
+    ReportWriter(const ReportWriter &);
+    ReportWriter &operator=(const ReportWriter &);
+
+    /**
+     * Writer thread. Writes items until the last one.
+     */
+    void run()
+    {
+        OutputBuffer out(file);
+        Item item;
+        for (;;)
+        {
+            queue.pop(item);
+            if (item.last)
+                break;
+
+            if (!item.text.empty())
+                out.write(&item.text[0], item.text.size());
+            write_dump_entries(out, item.mode, item.dump);
+            written.store(written.load(memory_order_relaxed) + 1, memory_order_release);
+        }
+    }
+
+    void push(Item &item)
+    {
+        queue.push(item);
+        pushed++;
+    }
+
+public:
+    /**
+     * Starts the writer thread.
+     *
+     * @param file {FILE*} Destination of the reports.
+     * @param capacity {size_t} Items handed over but not written yet, at
+     * most.
+     */
+    ReportWriter(FILE *file, size_t capacity = 16)
+        : file(file), queue(capacity), pushed(0), written(0), worker(&ReportWriter::run, this)
+    {
+    }
+
+    ~ReportWriter()
+    {
+        finish();
+    }
+
+    /**
+     * Hands over a chunk of report text. Called by OutputBuffer.
+     */
+    void consume(const char *data, size_t length)
+    {
+        Item item;
+        item.text.assign(data, data + length);
+        push(item);
+    }
+
+    /**
+     * Hands over a recorded dump. Text written to the OutputBuffer before
+     * should be flushed first, so it is written before the dump.
+     *
+     * @param mode {DumpMode} Format the dump is recorded for.
+     * @param entries {vector<DumpEntry>} Recorded nodes, taken and cleared.
+     * Their names must stay in place until wait() returns.
+     */
+    void write_dump(DumpMode mode, vector<DumpEntry> &entries)
+    {
+        Item item;
+        item.mode = mode;
+        item.dump.swap(entries);
+        push(item);
+    }
+
+    /**
+     * Waits until everything handed over is written, e.g. before names of
+     * recorded dumps are freed.
+     */
+    void wait()
+    {
+        while (written.load(memory_order_acquire) != pushed)
+            this_thread::yield();
+    }
+
+    /**
+     * Writes everything handed over and stops the writer thread. Nothing can
+     * be handed over after this.
+     */
+    void finish()
+    {
+        if (!worker.joinable())
+            return;
+
+        Item item;
+        item.last = true;
+        queue.push(item);
+        worker.join();
+    }
+};
+
+#endif
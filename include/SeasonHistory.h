@@ -0,0 +1,349 @@
+/**
+ * SeasonHistory class. Compact per-season scores of a player.
+ */
+
+#ifndef SEASONHISTORY_H
+#define SEASONHISTORY_H
+
+#include <cstddef> // NULL
+#include <cstdlib> // realloc, free
+#include <cstring> // memcpy
+
+using namespace std;
+
+/**
+ * Scores of a player in every season with a row, oldest first.
+ *
+ * Seasons are stored as a byte stream. A record is the season index and the
+ * point, assist and rebound of the season, each as the difference from the
+ * previous record, zigzag and varint encoded. Consecutive seasons and
+ * similar scores take one or two bytes per value, so a season typically
+ * costs 4 to 7 bytes.
+ *
+ * The history is a single pointer, NULL until the first season is added,
+ * so players of runs without --history carry only that pointer. The block
+ * it points to also keeps the position and the values of the last record,
+ * so adding a row is O(1) however many seasons the player has.
+ */
+class SeasonHistory
+{
+public:
+    /**
+     * Scores of one season.
+     */
+    struct Season
+    {
+        int season; // Season index
+        int point;
+        int assist;
+        int rebound;
+
+        Season() : season(0), point(0), assist(0), rebound(0)
+        {
+        }
+    };
+
+private:
+    /**
+     * Header of the allocated block, the encoded bytes follow it.
+     */
+    struct Block
+    {
+        unsigned int length;   // Encoded bytes
+        unsigned int capacity; // Bytes allocated after the header
+        unsigned int last_pos; // Start of the last record
+        Season last;           // Values of the last record
+
+        unsigned char *bytes()
+        {
+            return reinterpret_cast<unsigned char *>(this + 1);
+        }
+
+        const unsigned char *bytes() const
+        {
+            return reinterpret_cast<const unsigned char *>(this + 1);
+        }
+    };
+
+    Block *block;
+
+    static unsigned int zigzag(int value)
+    {
+        return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+    }
+
+    static int unzigzag(unsigned int value)
+    {
+        return (int)(value >> 1) ^ -(int)(value & 1);
+    }
+
+    void reserve(unsigned int size)
+    {
+        unsigned int capacity = block != NULL ? block->capacity : 0;
+        if (size <= capacity)
+            return;
+
+        unsigned int new_capacity = capacity == 0 ? 8 : capacity;
+        while (new_capacity < size)
+            new_capacity *= 2;
+
+        bool first = block == NULL;
+        block = (Block *)realloc(block, sizeof(Block) + new_capacity);
+        block->capacity = new_capacity;
+        if (first)
+        {
+            block->length = 0;
+            block->last_pos = 0;
+            block->last = Season();
+        }
+    }
+
+    /**
+     * Appends a varint, at most 5 bytes. Space must be reserved.
+     */
+    void put_varint(unsigned int value)
+    {
+        unsigned char *bytes = block->bytes();
+        while (value >= 0x80)
+        {
+            bytes[block->length++] = (unsigned char)(value | 0x80);
+            value >>= 7;
+        }
+        bytes[block->length++] = (unsigned char)value;
+    }
+
+    unsigned int get_varint(unsigned int &pos) const
+    {
+        const unsigned char *bytes = block->bytes();
+        unsigned int value = 0;
+        for (int shift = 0; pos < block->length; shift += 7)
+        {
+            unsigned char byte = bytes[pos++];
+            value |= (unsigned int)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                break;
+        }
+        return value;
+    }
+
+    /**
+     * Decodes the record at pos, which follows prev.
+     */
+    void get_season(unsigned int &pos, const Season &prev, Season &season) const
+    {
+        season.season = prev.season + unzigzag(get_varint(pos));
+        season.point = prev.point + unzigzag(get_varint(pos));
+        season.assist = prev.assist + unzigzag(get_varint(pos));
+        season.rebound = prev.rebound + unzigzag(get_varint(pos));
+    }
+
+    /**
+     * Appends the record of season, which follows prev, and makes it the
+     * last record.
+     */
+    void put_season(const Season &prev, const Season &season)
+    {
+        reserve(size() + 20);
+        block->last_pos = block->length;
+        put_varint(zigzag(season.season - prev.season));
+        put_varint(zigzag(season.point - prev.point));
+        put_varint(zigzag(season.assist - prev.assist));
+        put_varint(zigzag(season.rebound - prev.rebound));
+        block->last = season;
+    }
+
+public:
+    SeasonHistory() : block(NULL)
+    {
+    }
+
+    /**
+     * Copies the block with its last record, without decoding it.
+     */
+    SeasonHistory(const SeasonHistory &v) : block(NULL)
+    {
+        *this = v;
+    }
+
+    SeasonHistory &operator=(const SeasonHistory &v)
+    {
+        if (this == &v)
+            return *this;
+
+        if (v.block == NULL || v.block->length == 0)
+        {
+            if (block != NULL)
+            {
+                block->length = 0;
+                block->last_pos = 0;
+                block->last = Season();
+            }
+            return *this;
+        }
+
+        reserve(v.block->length);
+        unsigned int capacity = block->capacity;
+        memcpy(block, v.block, sizeof(Block) + v.block->length);
+        block->capacity = capacity;
+        return *this;
+    }
+
+    /**
+     * Takes the block of another history, which is left empty.
+     */
+    SeasonHistory(SeasonHistory &&v) : block(v.block)
+    {
+        v.block = NULL;
+    }
+
+    SeasonHistory &operator=(SeasonHistory &&v)
+    {
+        if (this != &v)
+        {
+            free(block);
+            block = v.block;
+            v.block = NULL;
+        }
+        return *this;
+    }
+
+    ~SeasonHistory()
+    {
+        free(block);
+    }
+
+    /**
+     * Adds scores of a row. Rows of the same season are summed, so seasons
+     * must be added in increasing order. O(1).
+     *
+     * @param season_index {int} Index of the season of the row.
+     * @param _point {int} Point of the row.
+     * @param _assist {int} Assist of the row.
+     * @param _rebound {int} Rebound of the row.
+     */
+    void add(int season_index, int _point, int _assist, int _rebound)
+    {
+        Season season;
+        season.season = season_index;
+        season.point = _point;
+        season.assist = _assist;
+        season.rebound = _rebound;
+
+        if (size() == 0)
+        {
+            put_season(Season(), season);
+            return;
+        }
+
+        Season last = block->last;
+        if (last.season != season_index)
+        {
+            put_season(last, season);
+            return;
+        }
+
+        // Another row of the last season, rewrite its record. The record
+        // before it is the last one minus the differences in its record.
+        Season diff, prev;
+        unsigned int pos = block->last_pos;
+        get_season(pos, Season(), diff);
+        prev.season = last.season - diff.season;
+        prev.point = last.point - diff.point;
+        prev.assist = last.assist - diff.assist;
+        prev.rebound = last.rebound - diff.rebound;
+
+        season.point += last.point;
+        season.assist += last.assist;
+        season.rebound += last.rebound;
+        block->length = block->last_pos;
+        put_season(prev, season);
+    }
+
+    /**
+     * Finds scores of a season.
+     *
+     * @param season_index {int} Index of the season.
+     * @param season {Season} Set to the scores if found.
+     *
+     * @return {bool} False if the player has no row in the season.
+     */
+    bool find(int season_index, Season &season) const
+    {
+        Season prev;
+        unsigned int pos = 0;
+        while (pos < size())
+        {
+            get_season(pos, prev, season);
+            if (season.season == season_index)
+                return true;
+            if (season.season > season_index)
+                return false;
+            prev = season;
+        }
+        return false;
+    }
+
+    /**
+     * Visits all seasons, oldest first.
+     *
+     * @param visit {Visitor} Called as visit(const Season&).
+     */
+    template <class Visitor>
+    void for_each(Visitor &visit) const
+    {
+        Season prev, season;
+        unsigned int pos = 0;
+        while (pos < size())
+        {
+            get_season(pos, prev, season);
+            visit(season);
+            prev = season;
+        }
+    }
+
+    /**
+     * Returns the encoded bytes, e.g. to write them to a snapshot.
+     */
+    const unsigned char *data() const
+    {
+        return block != NULL ? block->bytes() : NULL;
+    }
+
+    /**
+     * Returns number of encoded bytes.
+     */
+    unsigned int size() const
+    {
+        return block != NULL ? block->length : 0;
+    }
+
+    /**
+     * Replaces the history with encoded bytes from data(). Decodes them
+     * once to find the last record.
+     */
+    void assign(const unsigned char *data, unsigned int size)
+    {
+        if (size == 0 && block == NULL)
+            return;
+
+        reserve(size);
+        if (size != 0)
+            memcpy(block->bytes(), data, size);
+        block->length = size;
+
+        // Find the last record
+        Season last;
+        unsigned int last_pos = 0;
+        unsigned int pos = 0;
+        while (pos < size)
+        {
+            Season prev = last;
+            last_pos = pos;
+            get_season(pos, prev, last);
+        }
+        block->last_pos = last_pos;
+        block->last = last;
+    }
+};
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * ShardedTree class. Player tree split into independent shards for updates
+ * from several threads.
+ */
+
+#ifndef SHARDEDTREE_H
+#define SHARDEDTREE_H
+
+#include <cstddef>
+#include <mutex>
+#include <queue>   // priority_queue
+#include <string>
+#include <utility> // forward, pair
+#include <vector>
+
+#include "CsvReader.h"
+#include "RedBlackTree.h"
+#include "StringInterner.h" // hash
+
+using namespace std;
+
+/**
+ * Red-black trees keyed by name. A name always goes to the shard given by
+ * its hash, so updates of different shards never touch the same tree.
+ *
+ * Each shard has a lock. Threads which update any shard use the locked
+ * methods. Alternatively every shard can be owned by a single thread, which
+ * then uses the owned methods without locking; rows are routed to their
+ * owner with shard_of.
+ *
+ * Sorted iteration merges the shards, so the whole index can still be
+ * listed in name order.
+ */
+template <class Data>
+class ShardedTree
+{
+public:
+    typedef RedBlackTree<Data, string> Tree;
+
+private:
+    struct Shard
+    {
+        mutex lock;
+        Tree tree;
+    };
+
+    vector<Shard *> shards;
+
+    /**
+     * Next node of a shard during a merge.
+     */
+    struct Cursor
+    {
+        typename Tree::iterator it;
+        size_t shard;
+
+        Cursor(typename Tree::iterator it, size_t shard) : it(it), shard(shard)
+        {
+        }
+    };
+
+    /**
+     * Orders cursors so that a priority_queue gives the smallest name first.
+     */
+    struct LaterName
+    {
+        bool operator()(const Cursor &l, const Cursor &r) const
+        {
+            return r.it->key < l.it->key;
+        }
+    };
+
+    ShardedTree(const ShardedTree &);
+    ShardedTree &operator=(const ShardedTree &);
+
+    static size_t name_hash(const string &name)
+    {
+        return StringInterner::hash(name.data(), name.length());
+    }
+
+    static size_t name_hash(const FieldView &name)
+    {
+        return StringInterner::hash(name.data, name.length);
+    }
+
+public:
+    /**
+     * @param count {size_t} Number of shards, at least one.
+     */
+    explicit ShardedTree(size_t count)
+    {
+        if (count == 0)
+            count = 1;
+        for (size_t i = 0; i < count; i++)
+            shards.push_back(new Shard());
+    }
+
+    ~ShardedTree()
+    {
+        for (size_t i = 0; i < shards.size(); i++)
+            delete shards[i];
+    }
+
+    size_t shard_count() const
+    {
+        return shards.size();
+    }
+
+    /**
+     * Returns the shard of a name.
+     *
+     * @param name {K} string or FieldView.
+     */
+    template <class K>
+    size_t shard_of(const K &name) const
+    {
+        return name_hash(name) % shards.size();
+    }
+
+    /**
+     * Finds the player with the given name, inserts a new one if it does not
+     * exist, then calls update with the shard locked.
+     *
+     * @param name {K} string or FieldView.
+     * @param data {D} Data of the new player, moved if it is a temporary.
+     * Not used if name exists.
+     * @param update {Update} Called as update(Node*, inserted).
+     */
+    template <class K, class D, class Update>
+    void apply(const K &name, D &&data, Update &update)
+    {
+        Shard &shard = *shards[shard_of(name)];
+        lock_guard<mutex> guard(shard.lock);
+
+        pair<Node<Data, string> *, bool> result = shard.tree.upsert(name, std::forward<D>(data));
+        update(result.first, result.second);
+        shard.tree.refresh(result.first);
+    }
+
+    /**
+     * Same as apply, without locking. Only the thread owning the shard of
+     * the name may call it.
+     */
+    template <class K, class D, class Update>
+    void apply_owned(const K &name, D &&data, Update &update)
+    {
+        RedBlackTree<Data, string> &tree = shards[shard_of(name)]->tree;
+        pair<Node<Data, string> *, bool> result = tree.upsert(name, std::forward<D>(data));
+        update(result.first, result.second);
+        tree.refresh(result.first);
+    }
+
+    /**
+     * Copies data of a player.
+     *
+     * @param name {K} string or FieldView.
+     * @param data {Data} Set to data of the player if found.
+     *
+     * @return {bool} False if the player is not found.
+     */
+    template <class K>
+    bool find(const K &name, Data &data)
+    {
+        Shard &shard = *shards[shard_of(name)];
+        lock_guard<mutex> guard(shard.lock);
+
+        Node<Data, string> *node = shard.tree.search(name);
+        if (node == NULL)
+            return false;
+        data = node->data;
+        return true;
+    }
+
+    /**
+     * Returns number of players in all shards. Should not be called while
+     * shards are updated.
+     */
+    size_t size() const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < shards.size(); i++)
+            count += shards[i]->tree.size();
+        return count;
+    }
+
+    /**
+     * Visits all players in name order. All shards are locked during the
+     * visit. Shards are merged with a heap of their next nodes, so
+     * O(n log shards).
+     *
+     * @param visit {Visitor} Called as visit(node).
+     */
+    template <class Visitor>
+    void inorder(Visitor &visit)
+    {
+        for (size_t i = 0; i < shards.size(); i++)
+            shards[i]->lock.lock();
+
+        priority_queue<Cursor, vector<Cursor>, LaterName> heap;
+        for (size_t i = 0; i < shards.size(); i++)
+        {
+            if (shards[i]->tree.begin() != shards[i]->tree.end())
+                heap.push(Cursor(shards[i]->tree.begin(), i));
+        }
+
+        while (!heap.empty())
+        {
+            // Shard with the smallest next name
+            Cursor next = heap.top();
+            heap.pop();
+
+            visit(&*next.it);
+            if (++next.it != shards[next.shard]->tree.end())
+                heap.push(next);
+        }
+
+        for (size_t i = shards.size(); i > 0; i--)
+            shards[i - 1]->lock.unlock();
+    }
+
+    /**
+     * Returns the tree of a shard, e.g. to print it. Should not be used
+     * while the shard is updated.
+     */
+    Tree &shard(size_t index)
+    {
+        return shards[index]->tree;
+    }
+};
+
+#endif
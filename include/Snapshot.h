@@ -0,0 +1,203 @@
+/**
+ * Binary snapshot files.
+ *
+ * Values are written in native byte order without padding. Strings are a
+ * uint16 length followed by the bytes, a longer string fails the write. A reader works on a memory mapped
+ * file and checks every read against the end of the data.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <climits> // USHRT_MAX, UINT_MAX
+#include <cstdio>  // FILE, fopen, rename
+#include <cstring> // memcpy
+#include <string>
+
+using namespace std;
+
+/**
+ * Writes a snapshot file. Data goes to path.tmp, which is renamed to path
+ * by commit, so a crash never leaves a partial snapshot behind.
+ */
+class SnapshotWriter
+{
+private:
+    string path;
+    string tmp_path;
+    FILE *file;
+    bool failed;
+
+    SnapshotWriter(const SnapshotWriter &);
+    SnapshotWriter &operator=(const SnapshotWriter &);
+
+public:
+    /**
+     * @param path {const char*} Path of the snapshot.
+     */
+    SnapshotWriter(const char *path) : path(path), tmp_path(string(path) + ".tmp"), failed(false)
+    {
+        file = fopen(tmp_path.c_str(), "wb");
+        if (file == NULL)
+            failed = true;
+    }
+
+    ~SnapshotWriter()
+    {
+        if (file != NULL)
+        {
+            fclose(file);
+            remove(tmp_path.c_str());
+        }
+    }
+
+    template <class T>
+    void write(const T &value)
+    {
+        if (!failed && fwrite(&value, sizeof(T), 1, file) != 1)
+            failed = true;
+    }
+
+    /**
+     * Writes a string with a uint16 length. Fails the snapshot if the
+     * string is longer, as its bytes would be read as the next values.
+     */
+    void write_string(const char *data, size_t length)
+    {
+        if (length > USHRT_MAX)
+            failed = true;
+        write((unsigned short)length);
+        if (!failed && length != 0 && fwrite(data, 1, length, file) != length)
+            failed = true;
+    }
+
+    void write_string(const string &str)
+    {
+        write_string(str.data(), str.length());
+    }
+
+    /**
+     * Writes a block of bytes with a uint32 length, for data which may be
+     * longer than a string.
+     */
+    void write_block(const void *data, size_t length)
+    {
+        if (length > UINT_MAX)
+            failed = true;
+        write((unsigned int)length);
+        if (!failed && length != 0 && fwrite(data, 1, length, file) != length)
+            failed = true;
+    }
+
+    /**
+     * Closes the file and moves it to its final path.
+     *
+     * @return {bool} False if any write failed.
+     */
+    bool commit()
+    {
+        if (file == NULL)
+            return false;
+
+        if (fclose(file) != 0)
+            failed = true;
+        file = NULL;
+
+        if (failed || rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Reads a snapshot from memory.
+ */
+class SnapshotReader
+{
+private:
+    const char *pos;
+    const char *end;
+    bool failed;
+
+public:
+    /**
+     * @param data {const char*} Start of the snapshot.
+     * @param length {size_t} Length of the snapshot.
+     */
+    SnapshotReader(const char *data, size_t length) : pos(data), end(data + length), failed(false)
+    {
+    }
+
+    /**
+     * Reads a value. Sets the failure flag and returns a zero value at the
+     * end of the data.
+     */
+    template <class T>
+    T read()
+    {
+        T value = T();
+        if (failed || (size_t)(end - pos) < sizeof(T))
+        {
+            failed = true;
+            return value;
+        }
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    /**
+     * Reads a string without copying it.
+     *
+     * @param data {const char*} Set to the start of the string.
+     *
+     * @return {size_t} Length of the string.
+     */
+    size_t read_string(const char *&data)
+    {
+        size_t length = read<unsigned short>();
+        if (failed || (size_t)(end - pos) < length)
+        {
+            failed = true;
+            data = pos;
+            return 0;
+        }
+        data = pos;
+        pos += length;
+        return length;
+    }
+
+    /**
+     * Reads a block written by write_block without copying it.
+     *
+     * @param data {const char*} Set to the start of the block.
+     *
+     * @return {size_t} Length of the block.
+     */
+    size_t read_block(const char *&data)
+    {
+        size_t length = read<unsigned int>();
+        if (failed || (size_t)(end - pos) < length)
+        {
+            failed = true;
+            data = pos;
+            return 0;
+        }
+        data = pos;
+        pos += length;
+        return length;
+    }
+
+    /**
+     * Returns whether any read went past the end of the data.
+     */
+    bool fail() const
+    {
+        return failed;
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * SpscQueue class. Bounded queue between two threads.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>  // yield
+#include <utility> // move
+#include <vector>
+
+using namespace std;
+
+/**
+ * Bounded lock-free ring buffer for a single producer thread and a single
+ * consumer thread. Each side writes only its own index, so a push or pop is
+ * one atomic load of the other index and one atomic store of its own.
+ *
+ * push waits while the queue is full and pop waits while it is empty, so a
+ * fast stage is held back by a slow one instead of buffering without limit.
+ */
+template <class T>
+class SpscQueue
+{
+private:
+    // Indexes grow without wrapping; slot of index i is i & mask
+    vector<T> slots;
+    size_t mask;
+
+    // Next slot to pop, written by the consumer only. Kept on its own cache
+    // line, so the two threads do not invalidate each other's index.
+    alignas(64) atomic<size_t> head;
+
+    // Next slot to push, written by the producer only
+    alignas(64) atomic<size_t> tail;
+
+    SpscQueue(const SpscQueue &);
+    SpscQueue &operator=(const SpscQueue &);
+
+public:
+    /**
+     * @param capacity {size_t} Number of slots, rounded up to a power of two.
+     */
+    explicit SpscQueue(size_t capacity) : head(0), tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * Adds a value if the queue is not full. Producer only.
+     *
+     * @param value {T} Moved into the queue if there is space.
+     *
+     * @return {bool} False if the queue is full.
+     */
+    bool try_push(T &value)
+    {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size())
+            return false;
+
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes the oldest value if the queue is not empty. Consumer only.
+     *
+     * @param value {T} Set to the oldest value.
+     *
+     * @return {bool} False if the queue is empty.
+     */
+    bool try_pop(T &value)
+    {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))
+            return false;
+
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * Adds a value, waits while the queue is full. Producer only.
+     */
+    void push(T &value)
+    {
+        while (!try_push(value))
+            this_thread::yield();
+    }
+
+    /**
+     * Takes the oldest value, waits while the queue is empty. Consumer only.
+     */
+    void pop(T &value)
+    {
+        while (!try_pop(value))
+            this_thread::yield();
+    }
+};
+
+#endif
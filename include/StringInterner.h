@@ -0,0 +1,147 @@
+/**
+ * StringInterner class.
+ */
+
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <cstring> // memcmp
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Maps strings to dense integer ids. Ids are given in order of first
+ * appearance, starting from zero.
+ *
+ * Uses an open addressing hash table of ids, so a lookup does not need a
+ * string object and does not allocate.
+ */
+class StringInterner
+{
+public:
+    /**
+     * Id used for "no string".
+     */
+    static const unsigned int NONE = 0xFFFFFFFFu;
+
+    /**
+     * FNV-1a hash of a character sequence.
+     */
+    static size_t hash(const char *data, size_t length)
+    {
+        size_t h = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+        {
+            h ^= (unsigned char)data[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+private:
+    // Strings by id. A deque, so strings do not move when others are added
+    // and references returned by str stay valid.
+    deque<string> strings;
+
+    // Hash table of ids, size is a power of two. Empty slots are NONE.
+    vector<unsigned int> table;
+
+    /**
+     * Finds the slot of a string. Slot is either empty or holds its id.
+     */
+    size_t find_slot(const char *data, size_t length) const
+    {
+        size_t mask = table.size() - 1;
+        size_t slot = hash(data, length) & mask;
+        while (table[slot] != NONE)
+        {
+            const string &str = strings[table[slot]];
+            if (str.length() == length && memcmp(str.data(), data, length) == 0)
+                break;
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    /**
+     * Doubles the table and reinserts all ids.
+     */
+    void grow()
+    {
+        vector<unsigned int> old(table.size() < 16 ? 16 : table.size() * 2, (unsigned int)NONE);
+        table.swap(old);
+        for (unsigned int id = 0; id < strings.size(); id++)
+            table[find_slot(strings[id].data(), strings[id].length())] = id;
+    }
+
+public:
+    StringInterner()
+    {
+        grow();
+    }
+
+    /**
+     * Returns id of a string. The string is added if it is not seen before.
+     *
+     * @param data {const char*} Characters of the string.
+     * @param length {size_t} Length of the string.
+     *
+     * @return {unsigned int} Id of the string.
+     */
+    unsigned int intern(const char *data, size_t length)
+    {
+        size_t slot = find_slot(data, length);
+        if (table[slot] != NONE)
+            return table[slot];
+
+        unsigned int id = strings.size();
+        strings.push_back(string(data, length));
+        table[slot] = id;
+
+        // Keep load factor under 1/2
+        if (strings.size() * 2 > table.size())
+            grow();
+        return id;
+    }
+
+    unsigned int intern(const string &str)
+    {
+        return intern(str.data(), str.length());
+    }
+
+    /**
+     * Returns id of a string without adding it.
+     *
+     * @param str {string} String to be searched.
+     *
+     * @return {unsigned int} Id of the string or NONE.
+     */
+    unsigned int find(const string &str) const
+    {
+        return table[find_slot(str.data(), str.length())];
+    }
+
+    /**
+     * Returns the string of an id. Empty string for NONE.
+     *
+     * @param id {unsigned int} Id returned by intern.
+     */
+    const string &str(unsigned int id) const
+    {
+        static const string empty;
+        return id == NONE ? empty : strings[id];
+    }
+
+    /**
+     * Returns number of interned strings.
+     */
+    size_t size() const
+    {
+        return strings.size();
+    }
+};
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Subtree maxima kept in RedBlackTree nodes.
+ */
+
+#ifndef SUBTREEMAX_H
+#define SUBTREEMAX_H
+
+/**
+ * Maxima of some values of Data over a subtree. The tree keeps them in every
+ * node, correct across inserts, rotations and removals, so the maximum of a
+ * key range is found in O(log n).
+ *
+ * Nothing is kept by default, and the empty default adds no bytes to a
+ * node (see NodeLinks). A specialization for a data type keeps STAT_COUNT
+ * values and has the same members; see PlayerData.h.
+ */
+template <class Data>
+struct SubtreeMax
+{
+    static const bool enabled = false;
+
+    /**
+     * Sets the maxima to the values of a single node.
+     */
+    void reset(const Data &)
+    {
+    }
+
+    /**
+     * Raises the maxima to the maxima of a child subtree.
+     */
+    void add(const SubtreeMax &)
+    {
+    }
+
+    bool operator==(const SubtreeMax &) const
+    {
+        return true;
+    }
+};
+
+#endif
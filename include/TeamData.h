@@ -0,0 +1,63 @@
+/**
+ * TeamData Class.
+ */
+
+#ifndef TEAMDATA_H
+#define TEAMDATA_H
+
+using namespace std;
+
+/**
+ * Scores of a team, summed over the rows of its players. A row counts for
+ * the team given in the row, so a player who changes team adds to the new
+ * team from then on and the old team keeps what the player scored before.
+ */
+struct TeamData
+{
+public:
+    int season; // Index of the season of the season totals, -1 before the first row
+    int rows;   // Rows in the season
+    int point;
+    int total_point;
+    int rebound;
+    int total_rebound;
+    int assist;
+    int total_assist;
+
+    TeamData()
+        : season(-1), rows(0), point(0), total_point(0), rebound(0), total_rebound(0), assist(0),
+          total_assist(0)
+    {
+    }
+
+    /**
+     * Adds a row of a player of the team. Season totals start from zero in a
+     * new season.
+     *
+     * @param season_index {int} Index of the season of the row.
+     * @param _point {int} Point of the row.
+     * @param _assist {int} Assist of the row.
+     * @param _rebound {int} Rebound of the row.
+     */
+    void add(int season_index, int _point, int _assist, int _rebound)
+    {
+        if (season != season_index)
+        {
+            season = season_index;
+            rows = 0;
+            point = 0;
+            assist = 0;
+            rebound = 0;
+        }
+
+        rows++;
+        point += _point;
+        assist += _assist;
+        rebound += _rebound;
+        total_point += _point;
+        total_assist += _assist;
+        total_rebound += _rebound;
+    }
+};
+
+#endif
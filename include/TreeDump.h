@@ -0,0 +1,232 @@
+/**
+ * Season-end dumps of the player tree.
+ */
+
+#ifndef TREEDUMP_H
+#define TREEDUMP_H
+
+#include <cstring> // strcmp
+#include <string>
+#include <vector>
+
+#include "Node.h"
+#include "OutputBuffer.h"
+#include "PlayerData.h"
+
+enum DumpMode
+{
+    DUMP_FULL,    // Whole tree in preorder, as text
+    DUMP_OFF,     // No tree output
+    DUMP_CHANGED, // Only players with a row in the finished season
+    DUMP_BINARY,  // Whole tree in preorder, as binary records
+};
+
+/**
+ * Parses name of a dump mode.
+ *
+ * @param name {const char*} One of full, off, changed, binary.
+ * @param mode {DumpMode} Set to the parsed mode.
+ *
+ * @return {bool} False if the name is unknown.
+ */
+inline bool parse_dump_mode(const char *name, DumpMode &mode)
+{
+    static const char *names[] = {"full", "off", "changed", "binary"};
+    for (int i = 0; i < 4; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            mode = (DumpMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Writes a node of a dump.
+ *
+ * A text line has a '-' per depth, "(BLACK) " or "(RED) " and the key. A
+ * binary dump starts with "RBT1" and has a record per node: depth {uint16},
+ * color {uint8}, key length {uint16} and the key bytes, in native byte order.
+ * It ends with a record of depth 0xFFFF.
+ */
+inline void write_dump_node(OutputBuffer &out, DumpMode mode, const string &name, int depth, Color color)
+{
+    if (mode == DUMP_BINARY)
+    {
+        out.write_raw((unsigned short)depth);
+        out.write_raw((unsigned char)color);
+        out.write_raw((unsigned short)name.length());
+        out << name;
+        return;
+    }
+
+    out.fill('-', depth);
+    out << (color == BLACK ? "(BLACK) " : "(RED) ") << name << '\n';
+}
+
+/**
+ * Node of a dump recorded to be written later, possibly by another thread.
+ * The name is not copied; it must stay in place until the entry is written.
+ */
+struct DumpEntry
+{
+    const string *name;
+    unsigned short depth;
+    unsigned char color;
+
+    DumpEntry(const string *name, int depth, Color color)
+        : name(name), depth((unsigned short)depth), color((unsigned char)color)
+    {
+    }
+};
+
+/**
+ * Tree visitor which records the nodes of a dump instead of writing them.
+ * Recording is cheaper than formatting, so the tree can be changed again
+ * sooner; write_dump_entries writes the dump later.
+ */
+template <class Keys>
+class DumpRecorder
+{
+private:
+    const Keys &keys;
+    DumpMode mode;
+    int season;
+    vector<DumpEntry> &entries;
+
+public:
+    /**
+     * @param keys {Keys} Maps tree keys to player names. Names must not move
+     * while entries are written.
+     * @param mode {DumpMode} Format of the dump.
+     * @param season {int} Index of the finished season, for DUMP_CHANGED.
+     * @param entries {vector<DumpEntry>} Recorded nodes are appended here.
+     */
+    DumpRecorder(const Keys &keys, DumpMode mode, int season, vector<DumpEntry> &entries)
+        : keys(keys), mode(mode), season(season), entries(entries)
+    {
+    }
+
+    template <class NodeType>
+    void operator()(const NodeType *node, int depth)
+    {
+        if (mode == DUMP_CHANGED && node->data.last_season != season)
+            return;
+
+        entries.push_back(DumpEntry(&keys.name(node->key), depth, node->color));
+    }
+};
+
+/**
+ * Tree visitor which writes nodes to an output buffer.
+ */
+template <class Key, class Keys>
+class TreeDumper
+{
+private:
+    OutputBuffer &out;
+    const Keys &keys;
+    DumpMode mode;
+    int season;
+
+public:
+    /**
+     * @param out {OutputBuffer} Destination of the dump.
+     * @param keys {Keys} Maps tree keys to player names.
+     * @param mode {DumpMode} Format of the dump.
+     * @param season {int} Index of the finished season, for DUMP_CHANGED.
+     */
+    TreeDumper(OutputBuffer &out, const Keys &keys, DumpMode mode, int season)
+        : out(out), keys(keys), mode(mode), season(season)
+    {
+    }
+
+    /**
+     * @param node {NodeType} Node of any tree backend, with key, color and
+     * data fields.
+     * @param depth {int} Depth of the node.
+     */
+    template <class NodeType>
+    void operator()(const NodeType *node, int depth)
+    {
+        if (mode == DUMP_CHANGED && node->data.last_season != season)
+            return;
+
+        write_dump_node(out, mode, keys.name(node->key), depth, node->color);
+    }
+};
+
+/**
+ * Dumps the whole player tree.
+ *
+ * @param tree {Tree} Tree of PlayerData.
+ * @param out {OutputBuffer} Destination of the dump.
+ * @param keys {Keys} Maps tree keys to player names.
+ * @param mode {DumpMode} Format of the dump.
+ * @param season {int} Index of the finished season, for DUMP_CHANGED.
+ */
+template <class Tree, class Keys>
+void dump_tree(Tree &tree, OutputBuffer &out, const Keys &keys, DumpMode mode, int season)
+{
+    if (mode == DUMP_OFF)
+        return;
+
+    if (mode == DUMP_BINARY)
+        out.write("RBT1", 4);
+
+    TreeDumper<typename Keys::key_type, Keys> dumper(out, keys, mode, season);
+    tree.preorder(dumper);
+
+    if (mode == DUMP_BINARY)
+        out.write_raw((unsigned short)0xFFFF);
+}
+
+/**
+ * Records the dump of the whole player tree, to be written later by
+ * write_dump_entries.
+ *
+ * @param tree {Tree} Tree of PlayerData.
+ * @param keys {Keys} Maps tree keys to player names.
+ * @param mode {DumpMode} Format of the dump.
+ * @param season {int} Index of the finished season, for DUMP_CHANGED.
+ * @param entries {vector<DumpEntry>} Recorded nodes are appended here.
+ */
+template <class Tree, class Keys>
+void record_dump(Tree &tree, const Keys &keys, DumpMode mode, int season, vector<DumpEntry> &entries)
+{
+    if (mode == DUMP_OFF)
+        return;
+
+    DumpRecorder<Keys> recorder(keys, mode, season, entries);
+    tree.preorder(recorder);
+}
+
+/**
+ * Writes a recorded dump. The output is the same as dump_tree at the time
+ * of recording.
+ *
+ * @param out {OutputBuffer} Destination of the dump.
+ * @param mode {DumpMode} Format the dump is recorded for.
+ * @param entries {vector<DumpEntry>} Nodes recorded by record_dump.
+ */
+inline void write_dump_entries(OutputBuffer &out, DumpMode mode, const vector<DumpEntry> &entries)
+{
+    if (mode == DUMP_OFF)
+        return;
+
+    if (mode == DUMP_BINARY)
+        out.write("RBT1", 4);
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const DumpEntry &entry = entries[i];
+        write_dump_node(out, mode, *entry.name, entry.depth, (Color)entry.color);
+    }
+
+    if (mode == DUMP_BINARY)
+        out.write_raw((unsigned short)0xFFFF);
+}
+
+#endif
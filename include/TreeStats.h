@@ -0,0 +1,57 @@
+/**
+ * Operation counters of RedBlackTree.
+ *
+ * Counters are compiled in only if RBT_STATS is defined (-DRBT_STATS).
+ * Otherwise RBT_STAT expands to nothing and the tree has no counter fields,
+ * so a normal build pays nothing for them.
+ */
+
+#ifndef TREESTATS_H
+#define TREESTATS_H
+
+#ifdef RBT_STATS
+#define RBT_STAT(statement) statement
+#else
+#define RBT_STAT(statement)
+#endif
+
+/**
+ * Counts of tree operations since the last reset.
+ */
+struct TreeStats
+{
+    unsigned long long comparisons;  // Key comparisons while descending the tree
+    unsigned long long rotations;    // rotate_left and rotate_right calls
+    unsigned long long recolorings;  // Color changes made by fix_insert
+    unsigned long long searches;     // Descents by search and upsert
+    unsigned long long search_steps; // Nodes visited by the descents
+    unsigned int max_search_depth;   // Most nodes visited by one descent
+
+    TreeStats()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        comparisons = 0;
+        rotations = 0;
+        recolorings = 0;
+        searches = 0;
+        search_steps = 0;
+        max_search_depth = 0;
+    }
+
+    /**
+     * Ends a descent which started when search_steps was first_step.
+     */
+    void end_search(unsigned long long first_step)
+    {
+        unsigned int depth = (unsigned int)(search_steps - first_step);
+        searches++;
+        if (depth > max_search_depth)
+            max_search_depth = depth;
+    }
+};
+
+#endif